@@ -6,6 +6,7 @@ extern "C" {
 extern syntax_tree *parse(const char *input);
 }
 #include "User.hpp"
+#include "mem_stats.hpp"
 #include <memory>
 #include <string>
 #include <vector>
@@ -85,6 +86,8 @@ class AST {
 };
 
 struct ASTNode {
+    MEM_STATS_COUNT_NEW(ASTNode)
+
     virtual Value* accept(ASTVisitor &) = 0;
     virtual ~ASTNode() = default;
 };
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <ostream>
+#include <string>
+
+#ifdef CMINUSF_MEM_STATS
+#include <llvm/Support/TypeName.h>
+#endif
+
+/**
+ * -mem-report 用到的分配统计: 按类统计分配次数、存活对象数与字节数
+ *
+ * 只有以 -DCMINUSF_MEM_STATS=ON 构建时才计数; 否则下面的宏展开为空,
+ * Tracked 是空基类, 不改变对象布局, 也没有运行时开销
+ */
+namespace mem_stats {
+
+struct Counter {
+    explicit Counter(std::string name);
+
+    std::string name;
+    std::size_t allocs{0};
+    std::size_t frees{0};
+    std::size_t bytes{0};
+    std::size_t live_bytes{0};
+    std::size_t peak_live_bytes{0};
+
+    void on_alloc(std::size_t size) {
+        ++allocs;
+        bytes += size;
+        live_bytes += size;
+        if (live_bytes > peak_live_bytes)
+            peak_live_bytes = live_bytes;
+    }
+    void on_free(std::size_t size) {
+        ++frees;
+        live_bytes -= size;
+    }
+};
+
+constexpr bool enabled() {
+#ifdef CMINUSF_MEM_STATS
+    return true;
+#else
+    return false;
+#endif
+}
+
+// 被计数的类的 operator new/delete 使用的底层分配函数, 定义在 .cpp 中,
+// 以免 GCC 内联后把 ::operator new 与类的 operator delete 误判为不匹配
+void *allocate(std::size_t size);
+void deallocate(void *ptr);
+
+// 按类输出所有计数器; 未开启统计时只输出一行提示
+void print_report(std::ostream &os);
+
+// 为不经过 operator new 单独分配的对象计数 (例如 use list 中的 Use 节点),
+// 以 sizeof(T) + Overhead 作为每个对象的字节数
+template <typename T, std::size_t Overhead = 0> struct Tracked {
+#ifdef CMINUSF_MEM_STATS
+    Tracked() { counter().on_alloc(sizeof(T) + Overhead); }
+    Tracked(const Tracked &) : Tracked() {}
+    Tracked &operator=(const Tracked &) = default;
+    ~Tracked() { counter().on_free(sizeof(T) + Overhead); }
+
+    static Counter &counter() {
+        static Counter c(llvm::getTypeName<T>().str());
+        return c;
+    }
+#endif
+};
+
+} // namespace mem_stats
+
+// 在类的 public 部分使用: 该类及其未重新声明此宏的子类的 new/delete
+// 都记在名为 Class 的计数器上, 字节数按动态类型的大小统计
+#ifdef CMINUSF_MEM_STATS
+#define MEM_STATS_COUNT_NEW(Class)                                             \
+    static ::mem_stats::Counter &mem_stats_counter() {                         \
+        static ::mem_stats::Counter c(#Class);                                 \
+        return c;                                                              \
+    }                                                                          \
+    static void *operator new(std::size_t size) {                              \
+        mem_stats_counter().on_alloc(size);                                    \
+        return ::mem_stats::allocate(size);                                    \
+    }                                                                          \
+    static void operator delete(void *ptr, std::size_t size) {                 \
+        mem_stats_counter().on_free(size);                                     \
+        ::mem_stats::deallocate(ptr);                                          \
+    }
+#else
+#define MEM_STATS_COUNT_NEW(Class)
+#endif
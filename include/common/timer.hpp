@@ -0,0 +1,49 @@
+#pragma once
+
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * 记录一次编译中各阶段 (parse, AST, IR gen, 每个 pass, print) 的耗时,
+ * 以及阶段结束时进程的峰值 RSS (getrusage 的 ru_maxrss).
+ * 按执行顺序保存, 同名阶段 (例如多次运行的 DeadCode) 各占一项
+ */
+class PhaseTimer {
+  public:
+    struct Phase {
+        std::string name;
+        double seconds;
+        long peak_rss_kb;
+    };
+
+    // 在作用域内为一个阶段计时, timer 为空时什么也不做
+    class Scope {
+      public:
+        Scope(PhaseTimer *timer, std::string name);
+        ~Scope();
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+      private:
+        PhaseTimer *timer_;
+        std::string name_;
+        std::chrono::steady_clock::time_point start_;
+    };
+
+    void record(std::string name, double seconds, long peak_rss_kb);
+    const std::vector<Phase> &get_phases() const { return phases_; }
+    double get_total() const;
+
+    // {"input": ..., "total": ..., "phases": [{"name": ..., "seconds": ...,
+    // "peak_rss_kb": ...}]}
+    void print_json(std::ostream &os, const std::string &input) const;
+    // 每个阶段一行: 名字, 耗时, 阶段结束时的峰值 RSS 及其相对上一阶段的增长
+    void print_table(std::ostream &os) const;
+
+    static long get_peak_rss_kb();
+
+  private:
+    std::vector<Phase> phases_;
+};
@@ -3,10 +3,10 @@
 #include "Instruction.hpp"
 #include "Value.hpp"
 
-#include <list>
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/SmallVector.h>
 #include <llvm/ADT/ilist.h>
 #include <llvm/ADT/ilist_node.h>
-#include <set>
 #include <string>
 
 class Function;
@@ -15,7 +15,9 @@ class Module;
 
 class BasicBlock : public Value, public llvm::ilist_node<BasicBlock> {
   public:
-    ~BasicBlock() = default;
+    MEM_STATS_COUNT_NEW(BasicBlock)
+
+    ~BasicBlock();
     static BasicBlock *create(Module *m, const std::string &name,
                               Function *parent) {
         auto prefix = name.empty() ? "" : "label_";
@@ -23,13 +25,15 @@ class BasicBlock : public Value, public llvm::ilist_node<BasicBlock> {
     }
 
     /****************api about cfg****************/
-    std::list<BasicBlock *> &get_pre_basic_blocks() { return pre_bbs_; }
-    std::list<BasicBlock *> &get_succ_basic_blocks() { return succ_bbs_; }
-
-    void add_pre_basic_block(BasicBlock *bb) { pre_bbs_.push_back(bb); }
-    void add_succ_basic_block(BasicBlock *bb) { succ_bbs_.push_back(bb); }
-    void remove_pre_basic_block(BasicBlock *bb) { pre_bbs_.remove(bb); }
-    void remove_succ_basic_block(BasicBlock *bb) { succ_bbs_.remove(bb); }
+    // CFG edges are derived from the terminating BranchInst: they are added
+    // when a branch is attached to the block and kept in sync when its
+    // targets change, so they are read-only here.
+    llvm::ArrayRef<BasicBlock *> get_pre_basic_blocks() const {
+        return pre_bbs_;
+    }
+    llvm::ArrayRef<BasicBlock *> get_succ_basic_blocks() const {
+        return succ_bbs_;
+    }
 
     // If the Block is terminated by ret/br
     bool is_terminated() const;
@@ -38,29 +42,26 @@ class BasicBlock : public Value, public llvm::ilist_node<BasicBlock> {
 
     /****************api about Instruction****************/
     void add_instruction(Instruction *instr);
-    void add_instr_begin(Instruction *instr) { instr_list_.push_front(instr); }
+    void add_instr_begin(Instruction *instr) {
+        instr_list_.push_front(instr);
+        attach_instr(instr);
+    }
     void erase_instr(Instruction *instr) { instr_list_.erase(instr); }
-    void remove_instr(Instruction *instr) { instr_list_.remove(instr); }
+    // Unlink instr without deleting it, its parent is reset to nullptr
+    void remove_instr(Instruction *instr) {
+        detach_instr(instr);
+        instr_list_.remove(instr);
+    }
     void insert_before(const llvm::ilist<Instruction>::iterator &pos,
                        Instruction *instr) {
         // Insert the new instruction before the position node
         instr_list_.insert(pos, instr);
+        attach_instr(instr);
     }
-
+    // pos must belong to this block
     void insert_before(Instruction *pos, Instruction *instr) {
-        auto it = instr_list_.begin();
-        for (; it != instr_list_.end(); ++it) {
-            if (&*it == pos) {
-                break;
-            }
-        }
-        if (it != instr_list_.end()) {
-            instr_list_.insert(it, instr);
-        }
-    }
-    void reset(){
-        pre_bbs_.clear();
-        succ_bbs_.clear();
+        assert(pos->get_parent() == this && "insert position not in block");
+        insert_before(pos->getIterator(), instr);
     }
 
     llvm::ilist<Instruction> &get_instructions() { return instr_list_; }
@@ -75,11 +76,25 @@ class BasicBlock : public Value, public llvm::ilist_node<BasicBlock> {
     virtual std::string print() override;
 
   private:
+    friend class BranchInst;
+    friend class Function;
+
     BasicBlock(const BasicBlock &) = delete;
     explicit BasicBlock(Module *m, const std::string &name, Function *parent);
 
-    std::list<BasicBlock *> pre_bbs_;
-    std::list<BasicBlock *> succ_bbs_;
+    // set parent of instr and add the edges of a branch
+    void attach_instr(Instruction *instr);
+    void detach_instr(Instruction *instr);
+    void add_succ_edge(BasicBlock *succ);
+    // remove one this->succ edge, no-op if the edge does not exist
+    void remove_succ_edge(BasicBlock *succ);
+    // remove every edge into and out of this block
+    void drop_all_edges();
+
+    // must be declared before instr_list_: a branch being destroyed with the
+    // block still unlinks its edges
+    llvm::SmallVector<BasicBlock *, 4> pre_bbs_;
+    llvm::SmallVector<BasicBlock *, 2> succ_bbs_;
     llvm::ilist<Instruction> instr_list_;
     Function *parent_;
 };
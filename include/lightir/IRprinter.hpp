@@ -10,5 +10,34 @@
 #include "User.hpp"
 #include "Value.hpp"
 
+#include <llvm/ADT/DenseMap.h>
+
+// Numbers the unnamed arguments, blocks and instructions of a function when
+// it is printed, so the IR never has to be renamed to be printed.
+class SlotTracker {
+  public:
+    explicit SlotTracker(Function *f);
+
+    // name without the '%' prefix: the user name, or argN/labelN/opN
+    std::string get_local_name(const Value *v) const;
+
+  private:
+    llvm::DenseMap<const Value *, unsigned> slots_;
+};
+
+// Makes slots the numbering used by print_as_op until it goes out of scope.
+// Without an active one, every local operand is numbered on demand, which is
+// only meant for printing single values while debugging.
+class SlotScope {
+  public:
+    explicit SlotScope(const SlotTracker &slots);
+    ~SlotScope();
+
+  private:
+    const SlotTracker *prev_;
+};
+
 std::string print_as_op(Value *v, bool print_ty);
+// name of a local value without the '%' prefix
+std::string print_local_name(Value *v);
 std::string print_instr_op_name(Instruction::OpID);
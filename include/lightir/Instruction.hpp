@@ -11,6 +11,8 @@ class Function;
 
 class Instruction : public User, public llvm::ilist_node<Instruction> {
   public:
+    MEM_STATS_COUNT_NEW(Instruction)
+
     enum OpID : uint32_t {
         // Terminator Instructions
         ret,
@@ -174,6 +176,14 @@ class ICmpInst : public BaseInst<ICmpInst> {
     static ICmpInst *create_lt(Value *v1, Value *v2, BasicBlock *bb);
     static ICmpInst *create_eq(Value *v1, Value *v2, BasicBlock *bb);
     static ICmpInst *create_ne(Value *v1, Value *v2, BasicBlock *bb);
+    static ICmpInst *create(OpID pred, Value *v1, Value *v2, BasicBlock *bb) {
+        return BaseInst<ICmpInst>::create(pred, v1, v2, bb);
+    }
+
+    // 交换两个操作数后等价的谓词, 如 lt -> gt
+    static OpID get_swapped_predicate(OpID pred);
+    // 结果取反后的谓词, 如 lt -> ge
+    static OpID get_inverse_predicate(OpID pred);
 
     virtual std::string print() override;
     Instruction *clone(BasicBlock *prt) const override;
@@ -211,13 +221,7 @@ public:
 
     virtual std::string print() override;
     Function *func_;
-    Instruction *clone(BasicBlock *prt) const override {
-            if(get_operands().size() == 1){
-                return new CallInst(func_, {}, prt);
-            }
-        return new CallInst(
-            func_, {get_operands().begin() + 1, get_operands().end()}, prt);
-    }
+    Instruction *clone(BasicBlock *prt) const override;
 };
 
 class BranchInst : public BaseInst<BranchInst> {
@@ -237,6 +241,13 @@ class BranchInst : public BaseInst<BranchInst> {
 
     Value *get_condition() const { return get_operand(0); }
 
+    unsigned get_num_successors() const { return is_cond_br() ? 2 : 1; }
+    // start from 0, the true target of a cond br is successor 0
+    BasicBlock *get_successor(unsigned i) const;
+
+    // keeps the CFG edges of the parent block in sync with the targets
+    void set_operand(unsigned i, Value *v) override;
+
     virtual std::string print() override;
     Instruction *clone(BasicBlock *prt) const override {
         if (is_cond_br())
@@ -7,11 +7,14 @@
 #include "Value.hpp"
 
 #include <list>
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/DenseSet.h>
 #include <llvm/ADT/ilist.h>
 #include <llvm/ADT/ilist_node.h>
-#include <map>
 #include <memory>
 #include <string>
+#include <vector>
 
 class GlobalVariable;
 class Function;
@@ -30,17 +33,51 @@ class Module {
 
     PointerType *get_pointer_type(Type *contained);
     ArrayType *get_array_type(Type *contained, unsigned num_elements);
-    FunctionType *get_function_type(Type *retty, std::vector<Type *> &args);
+    FunctionType *get_function_type(Type *retty, llvm::ArrayRef<Type *> args);
 
     void add_function(Function *f);
     llvm::ilist<Function> &get_functions();
     void add_global_variable(GlobalVariable *g);
     llvm::ilist<GlobalVariable> &get_global_variable();
 
-    void set_print_name();
     std::string print();
 
   private:
+    // Looks a function type up by a (return, params) key that only views the
+    // caller's parameter list, so a hit does not allocate.
+    struct FunctionTypeKeyInfo {
+        struct KeyTy {
+            Type *result;
+            llvm::ArrayRef<Type *> params;
+            unsigned hash;
+
+            KeyTy(Type *result, llvm::ArrayRef<Type *> params)
+                : result(result), params(params),
+                  hash(FunctionType::hash(result, params)) {}
+            bool operator==(const KeyTy &other) const {
+                return result == other.result and params == other.params;
+            }
+        };
+        static FunctionType *getEmptyKey() {
+            return llvm::DenseMapInfo<FunctionType *>::getEmptyKey();
+        }
+        static FunctionType *getTombstoneKey() {
+            return llvm::DenseMapInfo<FunctionType *>::getTombstoneKey();
+        }
+        static unsigned getHashValue(const KeyTy &key) { return key.hash; }
+        static unsigned getHashValue(const FunctionType *ty) {
+            return ty->get_hash();
+        }
+        static bool isEqual(const KeyTy &lhs, const FunctionType *rhs) {
+            if (rhs == getEmptyKey() or rhs == getTombstoneKey())
+                return false;
+            return lhs == KeyTy(rhs->get_return_type(), rhs->get_params());
+        }
+        static bool isEqual(const FunctionType *lhs, const FunctionType *rhs) {
+            return lhs == rhs;
+        }
+    };
+
     // The global variables in the module
     llvm::ilist<GlobalVariable> global_list_;
     // The functions in the module
@@ -51,9 +88,9 @@ class Module {
     std::unique_ptr<Type> label_ty_;
     std::unique_ptr<Type> void_ty_;
     std::unique_ptr<FloatType> float32_ty_;
-    std::map<Type *, std::unique_ptr<PointerType>> pointer_map_;
-    std::map<std::pair<Type *, int>, std::unique_ptr<ArrayType>> array_map_;
-    std::map<std::pair<Type *, std::vector<Type *>>,
-             std::unique_ptr<FunctionType>>
-        function_map_;
+    llvm::DenseMap<Type *, std::unique_ptr<PointerType>> pointer_map_;
+    llvm::DenseMap<std::pair<Type *, unsigned>, std::unique_ptr<ArrayType>>
+        array_map_;
+    llvm::DenseSet<FunctionType *, FunctionTypeKeyInfo> function_map_;
+    std::vector<std::unique_ptr<FunctionType>> function_types_;
 };
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <iostream>
+#include <llvm/ADT/ArrayRef.h>
 #include <vector>
 
 class Module;
@@ -63,23 +64,28 @@ class IntegerType : public Type {
 
 class FunctionType : public Type {
   public:
-    FunctionType(Type *result, std::vector<Type *> params);
+    FunctionType(Type *result, llvm::ArrayRef<Type *> params);
 
     static bool is_valid_return_type(Type *ty);
     static bool is_valid_argument_type(Type *ty);
 
-    static FunctionType *get(Type *result, std::vector<Type *> params);
+    static FunctionType *get(Type *result, llvm::ArrayRef<Type *> params);
+    // hash of a signature, used to unique function types in the module
+    static unsigned hash(Type *result, llvm::ArrayRef<Type *> params);
 
     unsigned get_num_of_args() const;
 
     Type *get_param_type(unsigned i) const;
     std::vector<Type *>::iterator param_begin() { return args_.begin(); }
     std::vector<Type *>::iterator param_end() { return args_.end(); }
+    llvm::ArrayRef<Type *> get_params() const { return args_; }
     Type *get_return_type() const;
+    unsigned get_hash() const { return hash_; }
 
   private:
     Type *result_;
     std::vector<Type *> args_;
+    unsigned hash_;
 };
 
 class ArrayType : public Type {
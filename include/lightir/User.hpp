@@ -15,7 +15,7 @@ class User : public Value {
     // start from 0
     Value *get_operand(unsigned i) const { return operands_.at(i); };
     // start from 0
-    void set_operand(unsigned i, Value *v);
+    virtual void set_operand(unsigned i, Value *v);
     void add_operand(Value *v);
 
     void remove_all_operands();
@@ -23,13 +23,16 @@ class User : public Value {
 
   private:
     std::vector<Value *> operands_; // operands of this value
+    // position of each operand's Use in the operand's use list
+    std::vector<std::list<Use>::iterator> use_iters_;
 };
 
 /* For example: op = func(a, b)
  *  for a: Use(op, 0)
  *  for b: Use(op, 1)
  */
-struct Use {
+// the extra two pointers are the links of the use list node
+struct Use : mem_stats::Tracked<Use, 2 * sizeof(void *)> {
     User *val_;       // used by whom
     unsigned arg_no_; // the no. of operand
 
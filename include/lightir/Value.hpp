@@ -6,6 +6,8 @@
 #include <string>
 #include <cassert>
 
+#include "mem_stats.hpp"
+
 class Type;
 class Value;
 class User;
@@ -13,18 +15,22 @@ struct Use;
 
 class Value {
   public:
-    explicit Value(Type *ty, const std::string &name = "")
-        : type_(ty), name_(name){};
-    virtual ~Value() { replace_all_use_with(nullptr); }
+    MEM_STATS_COUNT_NEW(Value)
+
+    explicit Value(Type *ty, const std::string &name = "");
+    virtual ~Value();
 
-    std::string get_name() const { return name_; };
+    // empty for unnamed values, which get a number only when printed
+    std::string get_name() const;
+    bool has_name() const { return has_name_; }
     Type *get_type() const { return type_; }
     const std::list<Use> &get_use_list() const { return use_list_; }
 
     bool set_name(std::string name);
 
-    void add_use(User *user, unsigned arg_no);
-    void remove_use(User *user, unsigned arg_no);
+    // the returned position lets the user remove the use in constant time
+    std::list<Use>::iterator add_use(User *user, unsigned arg_no);
+    void remove_use(std::list<Use>::iterator use);
 
     void replace_all_use_with(Value *new_val);
     void replace_use_with_if(Value *new_val, std::function<bool(Use *)> pred);
@@ -56,5 +62,5 @@ class Value {
   private:
     Type *type_;
     std::list<Use> use_list_; // who use this value
-    std::string name_;        // should we put name field here ?
+    bool has_name_{false};    // the name itself lives in a side table
 };
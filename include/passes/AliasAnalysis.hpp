@@ -0,0 +1,72 @@
+#pragma once
+
+#include "FuncInfo.hpp"
+#include "Instruction.hpp"
+#include "PassManager.hpp"
+
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/SmallPtrSet.h>
+#include <memory>
+
+enum class AliasResult { NoAlias, MayAlias, MustAlias };
+
+/**
+ * 别名分析: 判断两个指针访问的内存是否重叠
+ *
+ * cminus 中的内存对象只有全局变量、alloca 和作为参数传入的数组, 指针
+ * 都由它们经 getelementptr 得到. 对两个指针先找到基址 (underlying object):
+ * - 不同的全局变量/alloca 互不重叠; 参数不会指向被调函数自己的 alloca.
+ * - 数组参数可能指向的对象在过程间计算: 所有调用点实参基址的并, 实参本身
+ *   是参数时取它的集合. 函数有直接调用以外的使用时视为未知.
+ * - 同一基址上的 gep 逐个比较下标: 相同的值或相等的常量继续比较,
+ *   不等的常量, 或同一个值加上不同常量 (i + 1 与 i + 2) 时不重叠.
+ *
+ * MustAlias 的含义是两个指针在 SSA 值相同时总是相等, 在循环中比较
+ * 不同迭代的访问时需要调用者自己保证.
+ */
+class AliasAnalysis : public Pass {
+  public:
+    explicit AliasAnalysis(Module *m)
+        : Pass(m), func_info_(std::make_shared<FuncInfo>(m)) {}
+
+    void run() override;
+
+    AliasResult alias(Value *ptr1, Value *ptr2) const;
+    bool may_alias(Value *ptr1, Value *ptr2) const {
+        return alias(ptr1, ptr2) != AliasResult::NoAlias;
+    }
+    bool must_alias(Value *ptr1, Value *ptr2) const {
+        return alias(ptr1, ptr2) == AliasResult::MustAlias;
+    }
+    // 调用是否可能读写 ptr 指向的内存, 依据 FuncInfo 的 mod/ref 摘要
+    bool call_may_access(CallInst *call, Value *ptr) const {
+        return call_may_read(call, ptr) or call_may_modify(call, ptr);
+    }
+    bool call_may_read(CallInst *call, Value *ptr) const {
+        return call_accesses(call, ptr, false);
+    }
+    bool call_may_modify(CallInst *call, Value *ptr) const {
+        return call_accesses(call, ptr, true);
+    }
+
+    // 去掉所有 gep 后的基址
+    static Value *get_underlying_object(Value *ptr);
+    // 全局变量与 alloca, 它们互不重叠
+    static bool is_identified_object(Value *obj);
+
+    FuncInfo *get_func_info() const { return func_info_.get(); }
+
+  private:
+    using ObjectSet = llvm::SmallPtrSet<Value *, 4>;
+
+    void compute_points_to();
+    bool call_accesses(CallInst *call, Value *ptr, bool is_write) const;
+    // 不同的基址是否可能是同一个对象
+    bool may_be_same_object(Value *obj1, Value *obj2) const;
+    // 参数可能指向的对象, 未知时返回 nullptr
+    const ObjectSet *get_points_to(Argument *arg) const;
+
+    std::shared_ptr<FuncInfo> func_info_;
+    llvm::DenseMap<Argument *, ObjectSet> points_to_;
+    llvm::SmallPtrSet<Argument *, 8> unknown_args_;
+};
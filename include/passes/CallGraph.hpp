@@ -0,0 +1,85 @@
+#pragma once
+
+#include "Instruction.hpp"
+#include "PassManager.hpp"
+
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/SmallVector.h>
+#include <memory>
+#include <vector>
+
+/**
+ * 调用图中的一个结点: 一个有定义的函数, 或代表所有外部函数
+ * (input/output/outputFloat/neg_idx_except 等声明) 的外部结点.
+ */
+class CallGraphNode {
+  public:
+    explicit CallGraphNode(Function *func) : func_(func) {}
+
+    // 外部结点返回 nullptr
+    Function *get_function() const { return func_; }
+    bool is_external() const { return func_ == nullptr; }
+
+    // 函数中的调用指令, 外部结点为空
+    llvm::ArrayRef<CallInst *> get_calls() const { return calls_; }
+    // 调用这个函数的指令, 外部结点是对所有外部函数的调用
+    llvm::ArrayRef<CallInst *> get_call_sites() const { return call_sites_; }
+    // 不重复的被调者与调用者
+    llvm::ArrayRef<CallGraphNode *> get_callees() const { return callees_; }
+    llvm::ArrayRef<CallGraphNode *> get_callers() const { return callers_; }
+
+    // 所在的强连通分量, 编号按被调者在前的顺序
+    unsigned get_scc_id() const { return scc_id_; }
+    // 所在分量中有多个函数, 或调用了自身
+    bool is_recursive() const { return recursive_; }
+
+  private:
+    friend class CallGraph;
+
+    Function *func_;
+    llvm::SmallVector<CallInst *, 4> calls_;
+    llvm::SmallVector<CallInst *, 4> call_sites_;
+    llvm::SmallVector<CallGraphNode *, 4> callees_;
+    llvm::SmallVector<CallGraphNode *, 4> callers_;
+    unsigned scc_id_{0};
+    bool recursive_{false};
+};
+
+/**
+ * 调用图分析
+ *
+ * 记录函数之间的调用关系与调用点, 并用 Tarjan 算法求出强连通分量,
+ * 按逆拓扑序 (被调者所在的分量在前) 排列, 供自底向上处理函数的过程间
+ * 优化使用. 外部函数统一由外部结点表示, 不参与强连通分量.
+ *
+ * 分析结果只描述 run 时的程序, 增删调用的优化之后需要重新 run.
+ */
+class CallGraph : public Pass {
+  public:
+    explicit CallGraph(Module *m) : Pass(m) {}
+
+    void run() override;
+
+    // 外部函数返回外部结点
+    CallGraphNode *get_node(Function *func) const;
+    CallGraphNode *get_external_node() const { return external_node_.get(); }
+
+    // 强连通分量, 被调者所在的分量在前
+    const std::vector<std::vector<Function *>> &get_sccs() const {
+        return sccs_;
+    }
+    bool is_recursive(Function *func) const {
+        return get_node(func)->is_recursive();
+    }
+
+    // for debug
+    void print();
+
+  private:
+    void compute_sccs();
+
+    std::unique_ptr<CallGraphNode> external_node_;
+    llvm::DenseMap<Function *, std::unique_ptr<CallGraphNode>> nodes_;
+    std::vector<std::vector<Function *>> sccs_;
+};
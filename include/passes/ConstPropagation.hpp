@@ -1,14 +1,17 @@
 #ifndef CONSTPROPAGATION_HPP
 #define CONSTPROPAGATION_HPP
+#include "CallGraph.hpp"
 #include "Constant.hpp"
-#include "IRBuilder.hpp"
 #include "Instruction.hpp"
 #include "Module.hpp"
 #include "PassManager.hpp"
 #include "Value.hpp"
 
-#include <stack>
-#include <unordered_map>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/DenseSet.h>
+#include <memory>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 ConstantFP *cast_constantfp(Value *value);
 ConstantInt *cast_constantint(Value *value);
@@ -17,35 +20,102 @@ class ConstFolder {
 public:
     ConstFolder(Module *m) : module_(m) {}
     // cminus only support binary operations
+    // 不能折叠时 (例如除以 0) 返回 nullptr
     ConstantInt *compute(Instruction::OpID op, ConstantInt *value1, ConstantInt *value2);
-    ConstantFP *compute(Instruction::OpID op, ConstantFP *value1, ConstantFP *value2);
-    // int -> float
-    ConstantFP *compute(Instruction::OpID op, ConstantInt *value1);
+    // 算术运算得到 ConstantFP, 比较运算得到 i1 的 ConstantInt
+    Constant *compute(Instruction::OpID op, ConstantFP *value1, ConstantFP *value2);
+    // int -> float, i1 -> int
+    Constant *compute(Instruction::OpID op, ConstantInt *value1);
     // float -> int
     ConstantInt *compute(Instruction::OpID op, ConstantFP *value1);
 
+    // 按 instr 的操作码对常量操作数求值, 操作数个数与类型不匹配或不能折叠时返回 nullptr
+    Constant *fold(Instruction *instr, Constant *value1, Constant *value2 = nullptr);
+
 private:
     Module *module_;
 };
 
+/**
+ * 稀疏条件常量传播 (SCCP), 运行在 Mem2Reg 之后的 SSA 上: 参见
+ * https://www.clear.rice.edu/comp512/Lectures/10Dead-Clean-SCCP.pdf
+ *
+ * 每个值在格 undef -> constant -> overdefined 上只会下降, 只有沿可执行的
+ * CFG 边到达的基本块与 phi 来源才参与求值. 求解结束后, 把常量值替换进
+ * 使用者, 把条件为常量的条件跳转改为无条件跳转, 并删除不可达的基本块.
+ *
+ * interprocedural 为 true 时 (IPSCCP) 对整个模块一起求解. 只通过直接调用
+ * 使用的函数 (不是 main, 由 CallGraph 给出全部调用点) 的参数与返回值也
+ * 参与求值: 入口块在某个调用点可执行后才可执行, 参数取各可执行调用点上
+ * 实参的交, 调用的结果取各可执行 ret 的返回值的交. 其余函数的参数与对
+ * 外部函数的调用结果都是 overdefined. 没有可执行调用点的函数保持不变.
+ */
 class ConstPropagation : public Pass {
 public:
-    ConstPropagation(Module *m) : Pass(m) {}
+    ConstPropagation(Module *m, bool interprocedural = false)
+        : Pass(m), folder_(m), interprocedural_(interprocedural) {}
     void run();
 
 private:
-    // clear blocks recursively from the start_bb
-    void clear_blocks_recs(BasicBlock *start_bb);
-
-    // check if the bb is the entry block in func
-    bool is_entry(BasicBlock *bb);
-    IRBuilder *builder = new IRBuilder(nullptr, m_);
-    std::vector<Instruction *> wait_delete;
-    ConstFolder *folder = new ConstFolder(m_);
-    // std::stack<GlobalVariable*>
-    std::unordered_map<GlobalVariable *, Constant *> globalvar_def;
-    // basic blocks that need to be removed
-    std::vector<BasicBlock *> delete_bb;
+    struct LatticeValue {
+        enum State { undef, constant, overdefined };
+        State state{undef};
+        Constant *value{nullptr};
+
+        bool operator==(const LatticeValue &other) const {
+            return state == other.state and value == other.value;
+        }
+        bool operator!=(const LatticeValue &other) const { return not(*this == other); }
+    };
+    using Edge = std::pair<BasicBlock *, BasicBlock *>;
+
+    // 一起求解 funcs 中的函数, 并改写其中可执行的函数
+    void run_on_funcs(const std::vector<Function *> &funcs);
+    void find_tracked_functions();
+
+    // 求解阶段
+    void solve();
+    bool resolve_undef_branches(Function *func);
+    LatticeValue get_lattice(Value *value);
+    void update(Value *value, LatticeValue new_value);
+    // 把 new_value 交到 value 当前的格值上
+    void merge(Value *value, LatticeValue new_value);
+    void mark_overdefined(Instruction *instr);
+    void mark_edge_executable(BasicBlock *from, BasicBlock *to);
+    bool is_edge_executable(BasicBlock *from, BasicBlock *to) const {
+        return executable_edges_.count({from, to});
+    }
+    void visit(Instruction *instr);
+    void visit_phi(PhiInst *phi);
+    void visit_branch(BranchInst *br);
+    void visit_foldable(Instruction *instr);
+    void visit_call(CallInst *call);
+    void visit_return(ReturnInst *ret);
+
+    // 改写阶段
+    void replace_constants(Function *func);
+    void rewrite_branches(Function *func);
+    void remove_dead_blocks(Function *func);
+
+    ConstFolder folder_;
+    bool interprocedural_;
+    std::unique_ptr<CallGraph> call_graph_;
+    // 参数与返回值参与求值的函数
+    llvm::DenseSet<Function *> tracked_functions_;
+    // 指令与被跟踪函数的参数的格值
+    llvm::DenseMap<Value *, LatticeValue> lattice_;
+    llvm::DenseMap<Function *, LatticeValue> return_lattice_;
+    llvm::DenseSet<Edge> executable_edges_;
+    std::unordered_set<BasicBlock *> executable_bbs_;
+    std::vector<Instruction *> instr_work_list_;
+    std::vector<BasicBlock *> bb_work_list_;
+
+    // 用以衡量常量传播的效果
+    int folded_count_{0};
+    int branch_count_{0};
+    int bb_count_{0};
+    int arg_count_{0};
+    int call_count_{0};
 };
 
 #endif
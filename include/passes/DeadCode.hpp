@@ -3,6 +3,8 @@
 #include "FuncInfo.hpp"
 #include "PassManager.hpp"
 
+#include <deque>
+#include <unordered_map>
 #include <unordered_set>
 
 /**
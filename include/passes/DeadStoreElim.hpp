@@ -0,0 +1,47 @@
+#pragma once
+
+#include "AliasAnalysis.hpp"
+#include "Instruction.hpp"
+#include "PassManager.hpp"
+
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/SmallPtrSet.h>
+#include <memory>
+#include <vector>
+
+/**
+ * 死 store 消除
+ *
+ * 三类 store 不会被任何读看到, 可以删除:
+ * - 块内被后面一个 MustAlias 的 store 覆盖, 且两者之间没有可能读到它的
+ *   load 或 call.
+ * - 基址是 alloca (局部数组), 且从它之后再也到达不了对这个数组的读:
+ *   对每个 alloca 求出能到达读的块, store 之后本块内没有读, 且所有后继
+ *   都不能到达读时, store 是死的.
+ * - 整个程序中只被写、从不被读的全局变量 (所有使用都是 store 的地址,
+ *   或是只用作 store 地址的 gep) 上的 store.
+ */
+class DeadStoreElim : public Pass {
+  public:
+    DeadStoreElim(Module *m) : Pass(m) {}
+
+    void run() override;
+
+  private:
+    void run_on_func(Function *func);
+    // 只被 store 写入的全局变量
+    void find_write_only_globals();
+    // 被后面的 store 覆盖的 store
+    void find_overwritten_stores(BasicBlock *bb);
+    // 之后不会再被读的局部数组上的 store
+    void find_unread_local_stores(Function *func);
+    // 指令是否可能读 ptr 指向的内存
+    bool may_read(Instruction *instr, Value *ptr);
+
+    std::unique_ptr<AliasAnalysis> alias_analysis_;
+    llvm::SmallPtrSet<Value *, 8> write_only_globals_;
+    llvm::SmallPtrSet<StoreInst *, 16> dead_stores_;
+
+    int overwritten_count_{0}; // 用以衡量消除的效果
+    int unread_count_{0};
+};
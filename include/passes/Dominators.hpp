@@ -17,6 +17,11 @@ class Dominators : public Pass {
 
     // functions for getting information
     BasicBlock *get_idom(BasicBlock *bb) { return idom_.at(bb); }
+    // 从入口不可达的块不在支配树上
+    bool is_reachable(BasicBlock *bb) {
+        auto it = idom_.find(bb);
+        return it != idom_.end() && it->second != nullptr;
+    }
     const BBSet &get_dominance_frontier(BasicBlock *bb) {
         return dom_frontier_.at(bb);
     }
@@ -1,35 +1,83 @@
 #pragma once
 
+#include "CallGraph.hpp"
+#include "GlobalVariable.hpp"
 #include "PassManager.hpp"
+#include "ValueRange.hpp"
 #include "logging.hpp"
 
-#include <deque>
+#include <llvm/ADT/SmallPtrSet.h>
+#include <memory>
 #include <unordered_map>
+#include <vector>
 
 /**
- * 计算哪些函数是纯函数
- * WARN:
- * 假定所有函数都是纯函数，除非他写入了全局变量、修改了传入的数组、或者直接间接调用了非纯函数
+ * 计算每个函数的 mod/ref 摘要
+ *
+ * 摘要记录函数 (包括它直接或间接调用的函数) 读写了哪些全局变量、读写了
+ * 哪些指针参数指向的内存, 是否调用了外部 I/O 函数, 是否可能执行到
+ * neg_idx_except, 以及是否可能不返回 (含有循环, 递归, 或调用
+ * neg_idx_except 结束程序).
+ * 对自己 alloca 的读写不计入摘要; 无法确定基址的访问记为未知.
+ *
+ * 先扫描每个函数自己的访问, 再沿 CallGraph 自底向上把被调函数的摘要
+ * 合并到调用者中, 直到不再变化: 被调函数读写第 i 个参数, 相当于调用者
+ * 读写第 i 个实参.
+ * 外部函数只通过指针参数访问内存, 除 neg_idx_except 外都视为有 I/O.
+ *
+ * 每个访问数组的函数都有负下标检查, 摘要中的 may_raise 只说明可能执行到
+ * neg_idx_except. 是否真的会执行由 may_raise(func) 按需判断: 用 ValueRange
+ * 分析函数自己, 下标一定非负的检查不会执行. 结果按函数缓存, 只在查询
+ * 只读/纯函数等需要时才计算, 重新 run 时清空.
  */
 class FuncInfo : public Pass {
   public:
+    struct Summary {
+        llvm::SmallPtrSet<GlobalVariable *, 4> read_globals;
+        llvm::SmallPtrSet<GlobalVariable *, 4> written_globals;
+        // 按参数序号
+        std::vector<bool> read_args;
+        std::vector<bool> written_args;
+        // 通过无法确定基址的指针读写
+        bool reads_unknown{false};
+        bool writes_unknown{false};
+        bool calls_io{false};
+        bool may_raise{false};
+        bool may_not_return{false};
+
+        bool may_read() const;
+        bool may_write() const;
+    };
+
     FuncInfo(Module *m) : Pass(m) {}
 
     void run();
 
-    bool is_pure_function(Function *func) const { return is_pure.at(func); }
+    // 没有分析过的函数返回最保守的摘要
+    const Summary &get_summary(Function *func) const;
+    // 不读写非局部的内存, 没有 I/O, 也不会抛出异常: 结果只取决于参数的值
+    bool is_pure_function(Function *func);
+    // 不写非局部的内存, 没有 I/O, 也不会抛出异常: 结果没有被使用的调用可以删除
+    bool is_read_only_function(Function *func);
+    // 调用 func 是否可能执行到 neg_idx_except, 按需计算
+    bool may_raise(Function *func);
 
   private:
-    std::deque<Function *> worklist;
-    std::unordered_map<Function *, bool> is_pure;
-
-    void trivial_mark(Function *func);
-    void process(Function *func);
+    // func 中是否有可能执行的负下标检查 (不含被调函数中的)
+    bool has_live_check(Function *func);
+    void compute_local(Function *func);
+    // 合并被调函数的摘要, 摘要有变化时返回 true
+    bool merge_callees(Function *func);
+    // 把对地址 ptr 的读或写记到 summary 中
+    void add_access(Summary &summary, Value *ptr, bool is_write);
     Value *get_first_addr(Value *val);
 
-    bool is_side_effect_inst(Instruction *inst);
-    bool is_local_load(LoadInst *inst);
-    bool is_local_store(StoreInst *inst);
+    std::unique_ptr<CallGraph> call_graph_;
+    std::unordered_map<Function *, Summary> summaries_;
+    // may_raise 的缓存与按需创建的区间分析
+    std::unordered_map<Function *, bool> may_raise_;
+    std::unique_ptr<ValueRange> value_range_;
+    Summary unknown_summary_;
 
     void log();
 };
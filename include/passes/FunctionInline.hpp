@@ -1,15 +1,35 @@
 #pragma once
 
+#include "CallGraph.hpp"
+#include "LoopInfo.hpp"
 #include "PassManager.hpp"
 
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
 
+/**
+ * 函数内联
+ *
+ * 按 CallGraph 给出的强连通分量顺序处理函数 (被调者所在的分量在前), 内联到
+ * 调用者中时被调函数已经完成了自己的内联. 递归函数 (所在分量有多个
+ * 函数或调用自身) 不被内联. 每个调用者维护一个调用点工作表, 内联后
+ * 复制进来的调用加入工作表, 不再从头扫描函数.
+ *
+ * 是否内联由代价模型决定: 代价是被调函数的指令数减去调用本身的开销,
+ * 常量实参 (内联后可以折叠)、唯一的调用点 (内联后函数本身不再需要)
+ * 会降低代价, 循环中的调用放宽阈值. 此外每个调用者和整个模块的指令数
+ * 都有增长上限.
+ */
 class FunctionInline : public Pass{
 public:
     FunctionInline(Module *m) : Pass(m) {}
 
     void run();
 
-    void inline_function(Instruction *dest, Function *func);
+    // 把 call 替换为 func 的函数体, 返回复制进来的调用
+    std::vector<CallInst *> inline_function(CallInst *call, Function *func);
 
     void inline_all_functions();
 
@@ -18,4 +38,26 @@ public:
                                         "outputFloat",
                                         "input",
                                         "neg_idx_except"};
-};
\ No newline at end of file
+
+private:
+    struct CallSite {
+        CallInst *call;
+        bool in_loop;
+    };
+
+    void inline_into(Function *caller);
+    int get_inline_cost(const CallSite &site);
+    static unsigned get_size(Function *func);
+
+    static constexpr int kInlineThreshold = 40;
+    static constexpr int kLoopBonus = 40;        // 循环中调用的阈值增量
+    static constexpr int kConstArgBonus = 5;     // 每个常量实参
+    static constexpr int kSingleCallBonus = 200; // 唯一的调用点
+    static constexpr unsigned kMinGrowthBudget = 200;
+
+    std::unique_ptr<LoopInfo> loop_info_;
+    std::unique_ptr<CallGraph> call_graph_;
+    unsigned module_size_{0};
+    unsigned module_budget_{0};
+    int inlined_count_{0}; // 用以衡量内联的效果
+};
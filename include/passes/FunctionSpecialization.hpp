@@ -0,0 +1,63 @@
+#pragma once
+
+#include "CallGraph.hpp"
+#include "ConstPropagation.hpp"
+#include "Instruction.hpp"
+#include "PassManager.hpp"
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+/**
+ * 针对常量实参的函数特化
+ *
+ * 把调用点按 (被调函数, 常量实参的位置与取值) 分组, 对每一组估计参数
+ * 取这些常量时函数中可以折叠的指令数: 从参数出发传播常量, 计入可以
+ * 折叠的指令, 以及条件变为常量后只有这一个前驱的后继块. 收益足够大
+ * (绝对值与相对函数大小都超过阈值) 的组按收益从大到小复制出特化版本,
+ * 常量直接代入副本, 该组的调用点 (包括副本中相同实参的递归调用) 改为
+ * 调用副本. 副本中的折叠留给之后的常量传播.
+ *
+ * 每个函数最多复制 kMaxClonesPerFunction 份, 复制的指令总数不超过模块
+ * 大小的 kMaxGrowthPercent%. 只通过直接调用使用的函数 (不是 main) 才会
+ * 被特化, 否则改写调用点后原函数仍要保留且调用点不完全可知.
+ */
+class FunctionSpecialization : public Pass {
+  public:
+    FunctionSpecialization(Module *m) : Pass(m), folder_(m) {}
+
+    void run() override;
+
+  private:
+    // 调用点上的常量实参: (参数序号, 常量), 按序号排列
+    using ConstArgs = std::vector<std::pair<unsigned, Constant *>>;
+    struct Candidate {
+        Function *callee;
+        ConstArgs args;
+        std::vector<CallInst *> calls;
+        int benefit{0};
+    };
+
+    void collect_candidates();
+    bool can_specialize(Function *func);
+    static ConstArgs get_const_args(CallInst *call);
+    // 估计参数取 args 中的常量时可以删去的指令数
+    int estimate_benefit(Function *func, const ConstArgs &args);
+    Function *clone_function(Function *func, const ConstArgs &args,
+                             const std::string &name);
+    static unsigned get_size(Function *func);
+
+    static constexpr int kMinBenefit = 4;
+    static constexpr int kMinBenefitPercent = 10; // 相对函数大小
+    static constexpr unsigned kMaxClonesPerFunction = 3;
+    static constexpr unsigned kMaxGrowthPercent = 50;
+    static constexpr unsigned kMinGrowthBudget = 200;
+
+    ConstFolder folder_;
+    std::unique_ptr<CallGraph> call_graph_;
+    std::vector<Candidate> candidates_;
+
+    int clone_count_{0}; // 用以衡量特化的效果
+    int call_count_{0};
+};
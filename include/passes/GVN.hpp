@@ -0,0 +1,67 @@
+#pragma once
+
+#include "Dominators.hpp"
+#include "FuncInfo.hpp"
+#include "Instruction.hpp"
+#include "PassManager.hpp"
+
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/SmallVector.h>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * 基于支配树作用域的全局值编号 (GVN) / 公共子表达式消除
+ *
+ * 沿支配树先序遍历, 以 (OpID, 类型, 操作数) 作为表达式的键; 若支配当前
+ * 指令的位置上已有相同的表达式, 就用它替换当前指令. 离开一个基本块的
+ * 支配子树时撤销该块加入的表达式.
+ *
+ * 只处理没有副作用、结果只取决于操作数的指令: 算术, 比较, 类型转换,
+ * getelementptr, 以及对纯函数 (FuncInfo::is_pure_function) 的调用.
+ * 交换律运算的操作数按地址排序, gt/ge 改写为交换操作数后的 lt/le.
+ *
+ * 对只读函数的调用, 结果还取决于内存: 表达式中加入内存的版本号, 每个
+ * store 或可能写内存的调用之后版本号更新. 块只有一个前驱时继承前驱结束
+ * 时的版本号, 否则使用新的版本号.
+ */
+class GVN : public Pass {
+  public:
+    GVN(Module *m) : Pass(m), func_info_(std::make_shared<FuncInfo>(m)) {}
+
+    void run() override;
+
+  private:
+    struct Expression {
+        Instruction::OpID op;
+        Type *type;
+        llvm::SmallVector<Value *, 4> operands;
+        unsigned memory{0}; // 不读内存的表达式为 0
+
+        bool operator==(const Expression &other) const {
+            return op == other.op and type == other.type and
+                   operands == other.operands and memory == other.memory;
+        }
+    };
+    struct ExpressionHash {
+        size_t operator()(const Expression &expr) const;
+    };
+
+    void run_on_func(Function *func);
+    // 返回 false 表示 instr 不参与值编号
+    bool get_expression(Instruction *instr, Expression &expr);
+    void process_block(BasicBlock *bb);
+
+    std::shared_ptr<FuncInfo> func_info_;
+    std::unique_ptr<Dominators> dominators_;
+    std::unordered_map<Expression, Instruction *, ExpressionHash> table_;
+    // 按进入顺序记录加入 table_ 的表达式, 离开作用域时弹出
+    std::vector<Expression> scope_stack_;
+    // 当前位置的内存版本号, 以及各块结束时的版本号
+    unsigned generation_{0};
+    unsigned next_generation_{0};
+    llvm::DenseMap<BasicBlock *, unsigned> end_generation_;
+
+    int ins_count_{0}; // 用以衡量 GVN 的效果
+};
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "CallGraph.hpp"
+#include "GlobalVariable.hpp"
+#include "Instruction.hpp"
+#include "PassManager.hpp"
+
+#include <memory>
+#include <vector>
+
+/**
+ * 全局变量的常量化与局部化
+ *
+ * Mem2Reg 不处理全局变量, 每次访问都要经过内存. 在整个程序的范围内
+ * 分析每个全局变量的使用 (直接的 load/store, 或只用作 load/store 地址的
+ * gep; 其他使用, 如作为参数传给函数, 视为逃逸, 不做处理):
+ * - 从不被写的全局变量, 读到的总是初值; 所有 store 写入同一个常量, 且
+ *   初值就是它, 或 main 入口块在任何读与调用之前写入它时, 读到的总是
+ *   这个常量. 这两种情况下把 load 替换为常量, 由后续的常量传播折叠.
+ * - 只在一个函数中使用的标量全局变量, 若函数是 main, 或者不递归且每条
+ *   从入口出发的路径都先写后读 (值不会跨调用保留), 就替换为该函数入口
+ *   块中的 alloca, 并以初值初始化. 之后再运行一次 Mem2Reg 即可提升.
+ */
+class GlobalOpt : public Pass {
+  public:
+    GlobalOpt(Module *m) : Pass(m) {}
+
+    void run() override;
+
+  private:
+    // 全局变量的所有访问
+    struct Accesses {
+        std::vector<LoadInst *> loads;
+        std::vector<StoreInst *> stores;
+        std::vector<Function *> funcs; // 访问它的函数, 不重复
+    };
+
+    // 有逃逸的使用时返回 false
+    bool collect_accesses(GlobalVariable *global, Accesses &accesses);
+    // 所有读都读到同一个常量时返回它, 否则返回 nullptr
+    Constant *get_constant_value(GlobalVariable *global,
+                                 const Accesses &accesses);
+    bool can_localize(GlobalVariable *global, const Accesses &accesses);
+    // 从 func 入口出发的每条路径上都先写 global 再读
+    bool is_stored_before_read(Function *func, GlobalVariable *global);
+    void localize(GlobalVariable *global, Function *func);
+    // 标量全局变量的初值
+    Constant *get_init_value(GlobalVariable *global);
+
+    std::unique_ptr<CallGraph> call_graph_;
+
+    int constant_count_{0}; // 用以衡量优化的效果
+    int localized_count_{0};
+};
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "AliasAnalysis.hpp"
+#include "Instruction.hpp"
+#include "LoopInfo.hpp"
+#include "PassManager.hpp"
+
+#include <llvm/ADT/DenseMap.h>
+#include <memory>
+#include <vector>
+
+/**
+ * 循环不变量外提 (LICM)
+ *
+ * 由内层循环到外层循环依次处理, 每个循环先按需创建 preheader:
+ * 1. 外提: 操作数都在循环外定义的指令移到 preheader 末尾. 可能陷入异常的
+ *    指令 (除法, 对只读函数的调用) 只在循环每次进入都会执行的块中外提;
+ *    load 要求地址一定可以访问, 且循环中没有可能写该地址的 store 或 call;
+ *    读内存的调用同样要求循环中没有写入它可能读到的内存.
+ * 2. 标量提升: 对循环中读写的同一个全局变量或常量下标的数组元素, 若循环中
+ *    其他访存都不可能与它重叠, 就在 preheader 中 load 一次, 循环内的
+ *    load/store 改为 SSA 值 (必要时插入 phi), 在每个出口写回.
+ *
+ * 地址之间的关系由 AliasAnalysis 判断.
+ */
+class LICM : public Pass {
+  public:
+    LICM(Module *m) : Pass(m) {}
+
+    void run() override;
+
+  private:
+    void run_on_func(Function *func);
+    void hoist(Loop *loop, BasicBlock *preheader);
+    void promote(Loop *loop, BasicBlock *preheader);
+
+    bool is_invariant(Loop *loop, Value *val) const;
+    bool can_hoist(Loop *loop, Instruction *instr);
+    // 不会陷入异常, 提前执行也不影响语义
+    bool is_safe_to_speculate(Instruction *instr) const;
+    // 只要进入循环, instr 就一定会在循环中的其他副作用之前执行
+    bool is_guaranteed_to_execute(Loop *loop, Instruction *instr);
+    // 调用可能不返回或有 I/O, 不能把可能陷入异常的指令移到它之前
+    bool is_barrier(CallInst *call) const;
+    // 循环是否有 exit block 的前驱不在循环内
+    bool has_dedicated_exits(Loop *loop) const;
+
+    // 访存分析
+    struct MemoryAccesses {
+        std::vector<LoadInst *> loads;
+        std::vector<StoreInst *> stores;
+        std::vector<CallInst *> calls;
+    };
+    void collect_accesses(Loop *loop);
+    static bool is_dereferenceable(Value *ptr);
+    bool may_be_written(Value *ptr) const;
+
+    // 标量提升时的 SSA 构造, 只在当前循环内进行
+    Value *read_at_entry(BasicBlock *bb);
+    Value *read_at_end(BasicBlock *bb);
+    Value *resolve(Value *val) const;
+    void remove_trivial_phis();
+
+    std::unique_ptr<AliasAnalysis> alias_analysis_;
+    std::unique_ptr<LoopInfo> loop_info_;
+    MemoryAccesses accesses_;
+
+    // 当前提升的地址的状态
+    Loop *promoted_loop_{nullptr};
+    Value *initial_value_{nullptr};
+    llvm::DenseMap<BasicBlock *, Value *> block_entry_value_;
+    // 记录 store 而不是存入的值: 存入的值可能是稍后才被替换的 load
+    llvm::DenseMap<BasicBlock *, StoreInst *> block_last_store_;
+    std::vector<PhiInst *> new_phis_;
+    // 已被替换的 load -> 替换它的值, 避免记录下来的值指向将被删除的 load
+    llvm::DenseMap<Value *, Value *> replaced_;
+
+    // 用以衡量 LICM 的效果
+    int hoisted_count_{0};
+    int promoted_count_{0};
+};
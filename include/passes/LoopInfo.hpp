@@ -0,0 +1,141 @@
+#pragma once
+
+#include "Dominators.hpp"
+#include "Instruction.hpp"
+#include "PassManager.hpp"
+
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/SmallPtrSet.h>
+#include <llvm/ADT/SmallVector.h>
+#include <memory>
+#include <vector>
+
+class LoopInfo;
+
+/**
+ * 一个自然循环: 由回边 latch -> header (header 支配 latch) 确定,
+ * 包含所有不经过 header 就能到达某个 latch 的基本块.
+ * 多条回边指向同一个 header 时合并为一个循环.
+ */
+class Loop {
+  public:
+    BasicBlock *get_header() const { return header_; }
+    // 外层循环, 最外层循环返回 nullptr
+    Loop *get_parent() const { return parent_; }
+    llvm::ArrayRef<Loop *> get_sub_loops() const { return sub_loops_; }
+    // 循环内的所有块 (包括子循环的块), header 总是第一个
+    llvm::ArrayRef<BasicBlock *> get_blocks() const { return blocks_; }
+    // 最外层循环的深度为 1
+    unsigned get_depth() const { return depth_; }
+
+    bool contains(BasicBlock *bb) const { return block_set_.count(bb); }
+    bool contains(const Loop *loop) const {
+        for (; loop != nullptr; loop = loop->parent_)
+            if (loop == this)
+                return true;
+        return false;
+    }
+    bool is_outermost() const { return parent_ == nullptr; }
+    bool is_innermost() const { return sub_loops_.empty(); }
+
+    // 回边的起点
+    llvm::ArrayRef<BasicBlock *> get_latches() const { return latches_; }
+    // 只有一个 latch 时返回它, 否则返回 nullptr
+    BasicBlock *get_latch() const {
+        return latches_.size() == 1 ? latches_.front() : nullptr;
+    }
+    // 循环内有后继在循环外的块
+    std::vector<BasicBlock *> get_exiting_blocks() const;
+    // 循环外有前驱在循环内的块, 不重复
+    std::vector<BasicBlock *> get_exit_blocks() const;
+    // 唯一的循环外前驱, 且它的唯一后继是 header; 否则返回 nullptr.
+    // 需要时用 LoopInfo::get_or_create_preheader 创建
+    BasicBlock *get_preheader() const;
+
+    // while 形循环的边界: header 是唯一的出口, 以 iv pred limit 决定是否
+    // 继续循环, iv = phi [init, preheader], [iv + step, latch], step 是
+    // 非零常量, limit 是循环不变量
+    struct Bounds {
+        BasicBlock *preheader;
+        BasicBlock *header;
+        BasicBlock *latch;
+        BasicBlock *body; // header 在循环内的后继
+        BasicBlock *exit; // header 在循环外的后继
+        PhiInst *iv;
+        Value *init;
+        int step;
+        Instruction::OpID pred;
+        Value *limit;
+    };
+    // 不是这种形式时返回 false
+    bool get_bounds(Bounds &bounds) const;
+
+  private:
+    friend class LoopInfo;
+
+    explicit Loop(BasicBlock *header) : header_(header) {}
+    void add_block(BasicBlock *bb) {
+        if (block_set_.insert(bb).second)
+            blocks_.push_back(bb);
+    }
+
+    BasicBlock *header_;
+    Loop *parent_{nullptr};
+    unsigned depth_{0};
+    llvm::SmallVector<Loop *, 2> sub_loops_;
+    llvm::SmallVector<BasicBlock *, 2> latches_;
+    std::vector<BasicBlock *> blocks_;
+    llvm::SmallPtrSet<BasicBlock *, 16> block_set_;
+};
+
+/**
+ * 循环分析: 在支配树上找出回边与自然循环, 建立循环嵌套森林.
+ * 从入口不可达的块不属于任何循环.
+ *
+ * 分析结果只描述 run 时的 CFG; 修改 CFG 的优化需要重新 run,
+ * get_or_create_preheader 是唯一会自行维护结果的修改
+ * (但不会更新内部的 Dominators).
+ */
+class LoopInfo : public Pass {
+  public:
+    explicit LoopInfo(Module *m) : Pass(m) {}
+
+    void run() override;
+    void run_on_func(Function *func);
+
+    // 函数中的最外层循环, 按 header 在支配树上的先序排列
+    llvm::ArrayRef<Loop *> get_top_level_loops(Function *func) const;
+    // 包含 bb 的最内层循环, 不在循环中时返回 nullptr
+    Loop *get_loop_for(BasicBlock *bb) const { return bb_map_.lookup(bb); }
+    // 不在循环中的块深度为 0
+    unsigned get_loop_depth(BasicBlock *bb) const {
+        auto loop = get_loop_for(bb);
+        return loop ? loop->get_depth() : 0;
+    }
+    bool is_loop_header(BasicBlock *bb) const {
+        auto loop = get_loop_for(bb);
+        return loop and loop->get_header() == bb;
+    }
+
+    // 返回 loop 的 preheader, 没有时新建一个: 循环外的前驱全部改为跳到
+    // 新块, header 中对应的 phi 来源合并到新块的 phi 中.
+    // header 是函数入口时无法创建, 返回 nullptr
+    BasicBlock *get_or_create_preheader(Loop *loop);
+
+    Dominators *get_dominators() { return dominators_.get(); }
+
+    // for debug
+    void print(Function *func);
+
+  private:
+    // 以 header 为根在 CFG 上逆向搜索, 找出循环体并连接已发现的内层循环
+    void discover_loop(Loop *loop, llvm::ArrayRef<BasicBlock *> latches);
+    // 按支配树先序为每个循环填充 blocks_
+    void populate_loops(Function *func);
+
+    std::unique_ptr<Dominators> dominators_;
+    std::vector<std::unique_ptr<Loop>> loops_;
+    llvm::DenseMap<Function *, llvm::SmallVector<Loop *, 4>> top_level_loops_;
+    llvm::DenseMap<BasicBlock *, Loop *> bb_map_;
+};
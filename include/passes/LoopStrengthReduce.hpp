@@ -0,0 +1,67 @@
+#pragma once
+
+#include "Instruction.hpp"
+#include "LoopInfo.hpp"
+#include "PassManager.hpp"
+
+#include <llvm/ADT/DenseMap.h>
+#include <map>
+#include <memory>
+#include <tuple>
+
+/**
+ * 循环强度削弱
+ *
+ * 基本归纳变量是 header 中形如 i = phi [init, preheader], [i + c, latch]
+ * 的 phi, c 为整数常量. 循环中由加, 减, 乘 (其中一侧循环不变) 构成的
+ * 表达式 scale * i + offset 称为派生归纳变量. 含有对 i 的乘法的派生
+ * 归纳变量改为一个新的归纳变量: 在 preheader 中计算初值, 每次迭代在
+ * latch 中加上 scale * c, 循环内的使用者改用它, 原来的乘法交给 DeadCode.
+ *
+ * 例如 a[i * n + j] 的下标在外层循环中只需每次迭代加 n.
+ */
+class LoopStrengthReduce : public Pass {
+  public:
+    LoopStrengthReduce(Module *m) : Pass(m) {}
+
+    void run() override;
+
+  private:
+    // scale * iv + offset, scale 与 offset 都是循环不变量;
+    // iv 为空时表示循环不变量 offset
+    struct Affine {
+        PhiInst *iv{nullptr};
+        Value *scale{nullptr};
+        Value *offset{nullptr};
+        // 计算过程中是否有与 iv 相关的乘法
+        bool has_mul{false};
+    };
+    struct InductionVariable {
+        Value *init;
+        ConstantInt *step;
+    };
+
+    void run_on_func(Function *func);
+    void run_on_loop(Loop *loop);
+    void find_induction_variables(Loop *loop);
+    // 不是仿射表达式时返回 false
+    bool get_affine(Value *val, Affine &affine);
+    bool compute_affine(Instruction *instr, Affine &affine);
+
+    // 在 preheader 末尾计算不变量, 常量直接折叠
+    Value *make_add(Value *lhs, Value *rhs);
+    Value *make_sub(Value *lhs, Value *rhs);
+    Value *make_mul(Value *lhs, Value *rhs);
+
+    std::unique_ptr<LoopInfo> loop_info_;
+
+    // 当前循环的状态
+    Loop *loop_{nullptr};
+    BasicBlock *preheader_{nullptr};
+    llvm::DenseMap<PhiInst *, InductionVariable> induction_vars_;
+    llvm::DenseMap<Value *, Affine> affine_cache_;
+    // (iv, scale, offset) -> 新的归纳变量, 相同的表达式只建一个
+    std::map<std::tuple<PhiInst *, Value *, Value *>, PhiInst *> new_ivs_;
+
+    int reduced_count_{0}; // 用以衡量强度削弱的效果
+};
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "Instruction.hpp"
+#include "LoopInfo.hpp"
+#include "PassManager.hpp"
+
+#include <llvm/ADT/DenseMap.h>
+#include <memory>
+#include <vector>
+
+/**
+ * 循环展开, 只处理最内层的、形如 while 的循环: 只有 header 是出口,
+ * header 以 icmp iv, n 决定是否继续, iv 每次迭代加上常量 step, n 是循环不变量.
+ *
+ * - 完全展开: iv 的初值与 n 都是常量时求出迭代次数 T, 若 T * 循环大小
+ *   不超过预算, 把循环体复制 T 份顺序执行, 原 header 只做最后一次判断.
+ * - 部分展开: 否则按 factor 展开. 新的 header 判断剩余迭代是否还有
+ *   factor 次, 是则连续执行 factor 份循环体 (中间不再判断), 否则进入原循环
+ *   执行剩余的迭代. n 不是常量时在前面加一个检查, n - (factor-1)*step
+ *   溢出时直接进入原循环.
+ *
+ * 复制基于 Instruction::clone, 之后按值映射改写操作数与 phi 的来源.
+ */
+class LoopUnroll : public Pass {
+  public:
+    LoopUnroll(Module *m, unsigned factor = 4) : Pass(m), factor_(factor) {}
+
+    void run() override;
+
+  private:
+    using LoopShape = Loop::Bounds;
+    using ValueMap = llvm::DenseMap<Value *, Value *>;
+    struct ClonedIterations {
+        BasicBlock *entry;
+        BasicBlock *last_latch;
+        // 执行完所有副本后 header 中各 phi 的值
+        ValueMap final_values;
+    };
+
+    // 迭代次数未知或超过 max_trip 时返回 -1
+    long get_trip_count(const LoopShape &shape, long max_trip) const;
+    unsigned get_loop_size(Loop *loop) const;
+
+    // 把循环的 count 次迭代复制成顺序执行的基本块, 最后一份的 latch 跳到 after;
+    // initial 给出第一次迭代时 header 中各 phi 的值
+    ClonedIterations clone_iterations(Loop *loop, const LoopShape &shape,
+                                      unsigned count, ValueMap initial,
+                                      BasicBlock *after);
+    void fully_unroll(Loop *loop, const LoopShape &shape, unsigned trip_count);
+    bool partially_unroll(Loop *loop, const LoopShape &shape);
+
+    unsigned factor_;
+    // 展开后新增的指令数上限
+    static constexpr unsigned kUnrollBudget = 256;
+    static constexpr long kMaxFullUnrollTrip = 32;
+
+    std::unique_ptr<LoopInfo> loop_info_;
+
+    // 用以衡量循环展开的效果
+    int full_count_{0};
+    int partial_count_{0};
+};
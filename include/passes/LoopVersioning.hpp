@@ -0,0 +1,61 @@
+#pragma once
+
+#include "LoopInfo.hpp"
+#include "PassManager.hpp"
+
+#include <llvm/ADT/DenseMap.h>
+#include <memory>
+#include <vector>
+
+/**
+ * 为负下标检查做循环版本化
+ *
+ * 对 Loop::get_bounds 能识别的最内层循环, 若其中有下标为 iv + c
+ * (c 为常量) 的负下标检查, 则 iv 在循环内的取值范围是 [init, limit) 等
+ * 一段区间, 只要区间端点满足若干常量比较, 这些检查就都不会失败.
+ * 在 preheader 中做这些比较, 都成立时进入删掉这些检查的循环副本,
+ * 否则进入原来的循环, 行为 (包括异常前的输出) 与原来完全一致.
+ * 比较在编译期就能确定成立时直接删除检查, 不复制循环.
+ *
+ * 除了下标本身, 还要保证 iv 与 iv + c 都不会回绕.
+ */
+class LoopVersioning : public Pass {
+  public:
+    LoopVersioning(Module *m) : Pass(m) {}
+
+    void run() override;
+
+  private:
+    // 循环中下标为 iv + offset 的检查
+    struct Check {
+        BasicBlock *bb;
+        BasicBlock *ok_bb;
+        BasicBlock *neg_bb;
+        long offset;
+    };
+    // 进入无检查副本的条件: value >= bound (is_lower) 或 value <= bound
+    struct Guard {
+        Value *value;
+        bool is_lower;
+        long bound;
+    };
+    using ValueMap = llvm::DenseMap<Value *, Value *>;
+
+    void run_on_loop(Loop *loop);
+    std::vector<Check> find_checks(Loop *loop, const Loop::Bounds &bounds);
+    // 返回 false 表示这些检查在循环中一定会失败一次, 不值得版本化
+    bool compute_guards(const Loop::Bounds &bounds,
+                        const std::vector<Check> &checks,
+                        std::vector<Guard> &guards);
+    void version_loop(Loop *loop, const Loop::Bounds &bounds,
+                      const std::vector<Check> &checks,
+                      const std::vector<Guard> &guards);
+
+    // 复制后的循环大小上限
+    static constexpr unsigned kMaxLoopSize = 512;
+
+    std::unique_ptr<LoopInfo> loop_info_;
+
+    int versioned_count_{0}; // 用以衡量版本化的效果
+    int removed_count_{0};
+};
@@ -35,7 +35,9 @@ class Mem2Reg : public Pass {
         return dynamic_cast<GetElementPtrInst *>(l_val) != nullptr;
     }
 
+    // 只提升 alloca; 参数与 phi 等其他指针在前面的优化之后也可能作为地址
     static inline bool is_valid_ptr(Value *l_val) {
-        return not is_global_variable(l_val) and not is_gep_instr(l_val);
+        return not is_global_variable(l_val) and not is_gep_instr(l_val) and
+               dynamic_cast<AllocaInst *>(l_val) != nullptr;
     }
 };
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "CallGraph.hpp"
+#include "FuncInfo.hpp"
+#include "Instruction.hpp"
+#include "PassManager.hpp"
+
+#include <memory>
+#include <vector>
+
+/**
+ * 纯递归函数的记忆化 (需要显式开启)
+ *
+ * 对满足以下条件的函数 f:
+ * - FuncInfo 证明是纯函数 (不读写非局部内存, 没有 I/O);
+ * - 有 1 或 2 个 int 参数, 返回 int 或 float;
+ * - 函数体中至少有两处调用同一强连通分量中的函数 (fib 这样的树形递归,
+ *   只有一处递归调用时记忆化没有收益);
+ * 新建包装函数 f_memo, 所有对 f 的调用 (包括 f 中的递归调用) 改为调用它.
+ * 包装函数以参数为下标查直接映射的全局表: 参数都在 [0, size) 中且表项
+ * 有效时直接返回记录的值, 否则调用 f 并填表; 参数越界时直接调用 f.
+ *
+ * 表由零初始化的全局数组实现, 程序开始时所有表项都无效.
+ */
+class Memoize : public Pass {
+  public:
+    Memoize(Module *m) : Pass(m) {}
+
+    void run() override;
+
+  private:
+    bool can_memoize(Function *func);
+    void memoize(Function *func);
+
+    // 每个参数的取值范围: 一个参数时 [0, 4096), 两个参数时 [0, 128)
+    static constexpr int kOneArgSize = 4096;
+    static constexpr int kTwoArgSize = 128;
+
+    std::unique_ptr<CallGraph> call_graph_;
+    std::unique_ptr<FuncInfo> func_info_;
+
+    int memoized_count_{0}; // 用以衡量记忆化的效果
+};
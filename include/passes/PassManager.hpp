@@ -1,8 +1,12 @@
 #pragma once
 
 #include "Module.hpp"
+#include "timer.hpp"
 
+#include <llvm/Support/TypeName.h>
 #include <memory>
+#include <string>
+#include <utility>
 #include <vector>
 
 class Pass {
@@ -21,16 +25,23 @@ class PassManager {
 
     template <typename PassType, typename... Args>
     void add_pass(Args &&...args) {
-        passes_.emplace_back(new PassType(m_, std::forward<Args>(args)...));
+        passes_.emplace_back(
+            llvm::getTypeName<PassType>().str(),
+            std::make_unique<PassType>(m_, std::forward<Args>(args)...));
     }
 
+    // 设置后, 每个 pass 的耗时以其类名记录到 timer 中
+    void set_timer(PhaseTimer *timer) { timer_ = timer; }
+
     void run() {
-        for (auto &pass : passes_) {
+        for (auto &[name, pass] : passes_) {
+            PhaseTimer::Scope scope(timer_, name);
             pass->run();
         }
     }
 
   private:
-    std::vector<std::unique_ptr<Pass>> passes_;
+    std::vector<std::pair<std::string, std::unique_ptr<Pass>>> passes_;
     Module *m_;
+    PhaseTimer *timer_{nullptr};
 };
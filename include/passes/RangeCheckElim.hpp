@@ -0,0 +1,24 @@
+#pragma once
+
+#include "PassManager.hpp"
+#include "ValueRange.hpp"
+
+#include <memory>
+
+/**
+ * 删除可以证明多余的负下标检查
+ *
+ * 对 match_neg_idx_check 匹配到的每个检查, 若 ValueRange 证明下标在该处
+ * 非负, 就改为直接跳到 idx.ok, 并删掉比较与 idx.neg 块.
+ */
+class RangeCheckElim : public Pass {
+  public:
+    RangeCheckElim(Module *m) : Pass(m) {}
+
+    void run() override;
+
+  private:
+    std::unique_ptr<ValueRange> value_range_;
+
+    int removed_count_{0}; // 用以衡量删除检查的效果
+};
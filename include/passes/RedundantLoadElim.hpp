@@ -0,0 +1,58 @@
+#pragma once
+
+#include "AliasAnalysis.hpp"
+#include "Instruction.hpp"
+#include "PassManager.hpp"
+
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/SmallVector.h>
+#include <memory>
+#include <vector>
+
+/**
+ * 冗余 load 消除与 store 到 load 的转发
+ *
+ * 按逆后序遍历基本块, 维护每个位置上 "地址 -> 其中的值" 的可用集合:
+ * - load 的地址与某个可用地址 MustAlias 时, 直接使用记录的值; 否则
+ *   记录这个 load 的结果.
+ * - store 先删去所有可能与它重叠的记录, 再记录存入的值.
+ * - call 删去被调函数可能写入的记录.
+ * 块入口的集合是所有前驱出口集合的交; 有前驱尚未处理 (回边) 时为空,
+ * 因此循环 header 不继承任何记录, 同一个 SSA 地址在集合中总表示同一地址.
+ * 各前驱在同一个地址上记录的值不同时, 在块首插入 phi 合并它们.
+ */
+class RedundantLoadElim : public Pass {
+  public:
+    RedundantLoadElim(Module *m) : Pass(m) {}
+
+    void run() override;
+
+  private:
+    struct Entry {
+        Value *ptr;
+        Value *val;
+        bool from_store; // 记录的值来自 store, 仅用于统计
+    };
+    using State = llvm::SmallVector<Entry, 8>;
+
+    void run_on_func(Function *func);
+    // 从入口可达的块的逆后序
+    std::vector<BasicBlock *> get_reverse_post_order(Function *func);
+    // 由各前驱出口的集合求 bb 入口的集合
+    State merge_predecessors(BasicBlock *bb);
+    void process_block(BasicBlock *bb, State &state);
+    void kill(State &state, Value *ptr);
+
+    // 每个位置最多记录的地址数
+    static constexpr unsigned kMaxEntries = 32;
+
+    std::unique_ptr<AliasAnalysis> alias_analysis_;
+    // 块在逆后序中的位置, 不可达的块不在其中
+    llvm::DenseMap<BasicBlock *, unsigned> rpo_index_;
+    llvm::DenseMap<BasicBlock *, State> end_states_;
+
+    // 用以衡量消除的效果
+    int load_count_{0};
+    int forward_count_{0};
+    int phi_count_{0};
+};
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "Instruction.hpp"
+#include "PassManager.hpp"
+
+#include <vector>
+
+/**
+ * 局部数组的标量替换 (Scalar Replacement of Aggregates)
+ *
+ * Mem2Reg 不处理经 getelementptr 得到的地址, 小的局部数组即使只用常量
+ * 下标访问也一直留在内存中. 对满足以下条件的数组 alloca:
+ * - 元素个数不超过 kMaxElements;
+ * - 所有使用都是 gep a, 0, c, c 为范围内的常量;
+ * - 这些 gep 只用作 load/store 的地址, 不会作为参数传给函数;
+ * 为每个元素在入口块创建一个标量 alloca, 把各个 gep 替换为对应元素的
+ * alloca. 之后再运行一次 Mem2Reg 即可把它们提升为 SSA 值.
+ *
+ * 局部数组没有初始化, 读到未写过的元素是未定义行为; 新的 alloca 在入口
+ * 块中初始化为 0, 这样 Mem2Reg 生成的 phi 在每个前驱上都有定值.
+ */
+class SROA : public Pass {
+  public:
+    SROA(Module *m) : Pass(m) {}
+
+    void run() override;
+
+  private:
+    void run_on_func(Function *func);
+    // alloca 的所有使用都是范围内常量下标的 load/store 时返回 true
+    bool can_split(AllocaInst *alloca);
+    void split(AllocaInst *alloca);
+
+    static constexpr unsigned kMaxElements = 16;
+
+    int split_count_{0}; // 用以衡量替换的效果
+};
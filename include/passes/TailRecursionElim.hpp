@@ -0,0 +1,41 @@
+#pragma once
+
+#include "Instruction.hpp"
+#include "PassManager.hpp"
+
+#include <optional>
+#include <vector>
+
+/**
+ * 尾递归消除
+ *
+ * 把函数对自身的尾调用改为跳回入口的循环: 在原入口块前新建一个入口,
+ * 原入口块成为循环头, 每个参数对应一个 phi, 尾调用的实参作为回边上的值.
+ *
+ * 除了 ret f(...) 形式的尾调用, 还处理 ret f(...) op x 与 ret x op f(...),
+ * 其中 op 是整数的 add 或 mul (满足结合律与交换律): 引入累加器 acc,
+ * 初值为 op 的单位元, 回边上为 acc op x, 其余的 ret v 改为 ret acc op v.
+ * 一个函数中只能使用一种 op, 使用其他 op 的调用点保持不变.
+ */
+class TailRecursionElim : public Pass {
+  public:
+    TailRecursionElim(Module *m) : Pass(m) {}
+
+    void run() override;
+
+  private:
+    // 以尾调用结束的返回块
+    struct TailCall {
+        BasicBlock *bb;
+        CallInst *call;
+        IBinaryInst *acc_op; // 以调用结果为操作数的 add/mul, 没有时为 nullptr
+    };
+
+    void run_on_func(Function *func);
+    // bb 以对 func 的尾调用结束时填写 tail_call
+    bool match_tail_call(Function *func, BasicBlock *bb, TailCall &tail_call);
+    void eliminate(Function *func, const std::vector<TailCall> &tail_calls,
+                   std::optional<Instruction::OpID> acc_op);
+
+    int eliminated_count_{0}; // 用以衡量消除的效果
+};
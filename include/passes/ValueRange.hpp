@@ -0,0 +1,101 @@
+#pragma once
+
+#include "Dominators.hpp"
+#include "Instruction.hpp"
+#include "PassManager.hpp"
+
+#include <climits>
+#include <llvm/ADT/DenseMap.h>
+#include <memory>
+#include <vector>
+
+/**
+ * 整数 (i32) 值的区间分析
+ *
+ * 在 SSA 上迭代求每个值的区间 [lo, hi]: 常量是单点, 加减乘按 64 位计算,
+ * 可能回绕时取全集; phi 取各来源的并, 同一个 phi 扩大多次后把变化的
+ * 一端放宽到 i32 的边界 (widening) 以保证收敛.
+ *
+ * 使用一个值时, 用支配当前块的分支条件收窄它的区间: 若块 B 只有唯一的
+ * 前驱 P 且 P 以 icmp 条件跳转到 B, 则该条件在 B 支配的所有块中成立.
+ * 例如 while (i < n) 的循环体中 i <= INT_MAX - 1, 于是 i + 1 不会回绕.
+ *
+ * 过程间只做简单的传递: 函数参数的区间是所有调用点实参区间的并,
+ * 调用的结果是被调函数所有返回值区间的并. 先假设它们都是全集, 每一轮
+ * 用上一轮的结果重新分析, 每一轮的结论都是可靠的.
+ */
+class ValueRange : public Pass {
+  public:
+    struct Range {
+        long lo{INT_MIN};
+        long hi{INT_MAX};
+
+        static Range full() { return {INT_MIN, INT_MAX}; }
+        static Range empty() { return {1, 0}; }
+        static Range constant(long c) { return {c, c}; }
+        bool is_empty() const { return lo > hi; }
+        bool is_full() const { return lo == INT_MIN and hi == INT_MAX; }
+        bool operator==(const Range &other) const {
+            return lo == other.lo and hi == other.hi;
+        }
+        bool operator!=(const Range &other) const { return not(*this == other); }
+        Range join(const Range &other) const;
+        Range intersect(const Range &other) const;
+    };
+
+    explicit ValueRange(Module *m) : Pass(m) {}
+
+    void run() override;
+    // 只分析 func, 参数与调用结果取全集; 之后 get_range 只对 func 中的值有效
+    void run_on_func(Function *func);
+
+    // val 在基本块 bb 中的区间, 已用支配 bb 的分支条件收窄
+    Range get_range(Value *val, BasicBlock *bb);
+
+  private:
+    // 支配树上从根到某个块路径上成立的条件, 以链表的形式共享前缀
+    struct Condition {
+        ICmpInst *cmp;
+        bool taken;
+        int parent;
+    };
+
+    void prepare_func(Function *func);
+    bool run_round();
+    void analyze_func(Function *func);
+    Range evaluate(Instruction *instr);
+
+    // 没有收窄的区间
+    Range get_base_range(Value *val);
+    Range refine(Value *val, Range range, int cond) const;
+    // cmp 的结果为 taken 时收窄 val 的区间
+    Range refine_by(Value *val, Range range, ICmpInst *cmp, bool taken) const;
+    int push_condition(ICmpInst *cmp, bool taken, int parent);
+
+    std::unique_ptr<Dominators> dominators_;
+    std::vector<Condition> conditions_;
+    // 块中成立的条件链的末尾, -1 表示没有条件; 不可达的块不在其中
+    llvm::DenseMap<BasicBlock *, int> block_condition_;
+    // 各函数中可达的块, 支配者在前
+    llvm::DenseMap<Function *, std::vector<BasicBlock *>> block_order_;
+
+    llvm::DenseMap<Value *, Range> ranges_;
+    llvm::DenseMap<Value *, int> widen_count_;
+    llvm::DenseMap<Argument *, Range> arg_ranges_;
+    llvm::DenseMap<Function *, Range> ret_ranges_;
+};
+
+/**
+ * 负下标检查. CminusfBuilder 为每次数组访问生成
+ *     %c = icmp sge i32 %idx, 0
+ *     br i1 %c, label %idx.ok, label %idx.neg
+ * idx.neg:
+ *     call void @neg_idx_except()
+ *     br label %idx.ok
+ * ValueRange 证明 %idx 非负时检查是多余的.
+ */
+// bb 以负下标检查结束时返回 true, 并给出下标与两个后继
+bool match_neg_idx_check(BasicBlock *bb, Value *&idx, BasicBlock *&ok_bb,
+                         BasicBlock *&neg_bb);
+// 把匹配到的检查改为直接跳到 ok_bb, 并删除 neg_bb
+void remove_neg_idx_check(BasicBlock *bb, BasicBlock *ok_bb, BasicBlock *neg_bb);
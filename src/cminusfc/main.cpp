@@ -5,13 +5,30 @@
 #include "cminusf_builder.hpp"
 #include "PassManager.hpp"
 #include "DeadCode.hpp"
+#include "DeadStoreElim.hpp"
 #include "Mem2Reg.hpp"
-// #include "ConstPropagation.hpp"
+#include "ConstPropagation.hpp"
 #include "FunctionInline.hpp"
+#include "FunctionSpecialization.hpp"
+#include "GVN.hpp"
+#include "GlobalOpt.hpp"
+#include "LICM.hpp"
+#include "LoopStrengthReduce.hpp"
+#include "LoopUnroll.hpp"
+#include "LoopVersioning.hpp"
+#include "Memoize.hpp"
+#include "RangeCheckElim.hpp"
+#include "RedundantLoadElim.hpp"
+#include "SROA.hpp"
+#include "TailRecursionElim.hpp"
+#include "mem_stats.hpp"
+#include "timer.hpp"
 
+#include <cstdlib>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <optional>
 #include <string>
 
 using std::string;
@@ -21,13 +38,33 @@ struct Config {
     string exe_name; // compiler exe name
     std::filesystem::path input_file;
     std::filesystem::path output_file;
+    // 非空时, 把各阶段耗时以 JSON 写入该文件
+    std::filesystem::path time_report_file;
 
     bool emitast{false};
     bool emitllvm{false};
+    // 编译结束后输出各阶段峰值 RSS 与按类统计的分配情况
+    bool mem_report{false};
     // optization config
     bool const_prop{false};
+    bool ipsccp{false};
     bool dce{false};
     bool func_inline{false};
+    bool func_spec{false};
+    bool tre{false};
+    bool memoize{false};
+    bool global_opt{false};
+    bool sroa{false};
+    bool gvn{false};
+    bool rle{false};
+    bool dse{false};
+    bool licm{false};
+    bool lsr{false};
+    bool rce{false};
+    bool loop_version{false};
+    bool unroll{false};
+    // 部分展开时每次迭代复制的循环体份数
+    unsigned unroll_factor{4};
 
     Config(int argc, char **argv) : argc(argc), argv(argv) {
         parse_cmd_line();
@@ -48,45 +85,154 @@ struct Config {
 int main(int argc, char **argv) {
     Config config(argc, argv);
 
-    auto syntax_tree = parse(config.input_file.c_str());
-    auto ast = AST(syntax_tree);
+    PhaseTimer timer;
+    auto *phase_timer =
+        config.time_report_file.empty() and not config.mem_report ? nullptr
+                                                                   : &timer;
+
+    syntax_tree *tree;
+    {
+        PhaseTimer::Scope scope(phase_timer, "parse");
+        tree = parse(config.input_file.c_str());
+    }
+    std::optional<AST> ast;
+    {
+        PhaseTimer::Scope scope(phase_timer, "AST");
+        ast.emplace(tree);
+    }
 
     if (config.emitast) { // if emit ast (lab1), print ast and return
         ASTPrinter printer;
-        ast.run_visitor(printer);
+        ast->run_visitor(printer);
     } else {
         std::unique_ptr<Module> m;
-        CminusfBuilder builder;
-        ast.run_visitor(builder);
-        m = builder.getModule();
+        {
+            PhaseTimer::Scope scope(phase_timer, "IR gen");
+            CminusfBuilder builder;
+            ast->run_visitor(builder);
+            m = builder.getModule();
+        }
 
         PassManager PM(m.get());
+        PM.set_timer(phase_timer);
         // optimization 
         if(config.dce) {
             PM.add_pass<Mem2Reg>();
             PM.add_pass<DeadCode>();
         }
 
+        // 尾递归消除会把树形递归中的一处调用变成循环, 记忆化要在它之前
+        if(config.memoize) {
+            PM.add_pass<Memoize>();
+            PM.add_pass<DeadCode>();
+        }
+
+        // 消除尾递归后函数可能不再递归, 放在内联之前
+        if(config.tre) {
+            PM.add_pass<TailRecursionElim>();
+            PM.add_pass<DeadCode>();
+        }
+
         if(config.func_inline) {
             PM.add_pass<FunctionInline>();
             PM.add_pass<DeadCode>();
         }
 
-        //if(config.const_prop) {
-        //    PM.add_pass<Mem2Reg>();
-        //    PM.add_pass<DeadCode>();
-        //    PM.add_pass<ConstPropagation>();
-        //    PM.add_pass<DeadCode>();
-        //}
+        // 局部化后的 alloca 需要再做一次 Mem2Reg
+        if(config.global_opt) {
+            PM.add_pass<GlobalOpt>();
+            PM.add_pass<Mem2Reg>();
+            PM.add_pass<DeadCode>();
+        }
+
+        // 拆分后的元素 alloca 需要再做一次 Mem2Reg
+        if(config.sroa) {
+            PM.add_pass<SROA>();
+            PM.add_pass<Mem2Reg>();
+            PM.add_pass<DeadCode>();
+        }
+
+        // 特化出的副本靠常量传播折叠代入的常量
+        if(config.func_spec) {
+            PM.add_pass<FunctionSpecialization>();
+            PM.add_pass<ConstPropagation>();
+            PM.add_pass<DeadCode>();
+        }
+
+        // -const-prop 要求 -dce, 此时 Mem2Reg 已经运行过
+        // -ipsccp 是过程间的版本, 同时给出时只运行它
+        if(config.ipsccp) {
+            PM.add_pass<ConstPropagation>(true);
+            PM.add_pass<DeadCode>();
+        } else if(config.const_prop) {
+            PM.add_pass<ConstPropagation>();
+            PM.add_pass<DeadCode>();
+        }
+
+        if(config.gvn) {
+            PM.add_pass<GVN>();
+            PM.add_pass<DeadCode>();
+        }
+
+        if(config.rle) {
+            PM.add_pass<RedundantLoadElim>();
+            PM.add_pass<DeadCode>();
+        }
+
+        if(config.dse) {
+            PM.add_pass<DeadStoreElim>();
+            PM.add_pass<DeadCode>();
+        }
+
+        if(config.licm) {
+            PM.add_pass<LICM>();
+            PM.add_pass<DeadCode>();
+        }
+
+        if(config.lsr) {
+            PM.add_pass<LoopStrengthReduce>();
+            PM.add_pass<DeadCode>();
+        }
+
+        if(config.rce) {
+            PM.add_pass<RangeCheckElim>();
+            PM.add_pass<DeadCode>();
+        }
+
+        if(config.loop_version) {
+            PM.add_pass<LoopVersioning>();
+            PM.add_pass<DeadCode>();
+        }
+
+        if(config.unroll) {
+            PM.add_pass<LoopUnroll>(config.unroll_factor);
+            PM.add_pass<DeadCode>();
+        }
         PM.run();
 
         std::ofstream output_stream(config.output_file);
         if (config.emitllvm) {
+            PhaseTimer::Scope scope(phase_timer, "print");
             auto abs_path = std::filesystem::canonical(config.input_file);
             output_stream << "; ModuleID = 'cminus'\n";
             output_stream << "source_filename = " << abs_path << "\n\n";
             output_stream << m->print();
         } 
+        PhaseTimer::Scope scope(phase_timer, "cleanup");
+        m.reset();
+        ast.reset();
+    }
+
+    if (config.mem_report) {
+        std::cout << "===== phases =====\n";
+        timer.print_table(std::cout);
+        std::cout << "===== allocations =====\n";
+        mem_stats::print_report(std::cout);
+    }
+    if (not config.time_report_file.empty()) {
+        std::ofstream report(config.time_report_file);
+        timer.print_json(report, config.input_file.string());
+        report << "\n";
     }
 
     return 0;
@@ -104,6 +250,15 @@ void Config::parse_cmd_line() {
             } else {
                 print_err("bad output file");
             }
+        } else if (argv[i] == "-time-report"s) {
+            if (time_report_file.empty() && i + 1 < argc) {
+                time_report_file = argv[i + 1];
+                i += 1;
+            } else {
+                print_err("bad time report file");
+            }
+        } else if (argv[i] == "-mem-report"s) {
+            mem_report = true;
         } else if (argv[i] == "-emit-ast"s) {
             emitast = true;
         } else if (argv[i] == "-emit-llvm"s) {
@@ -112,8 +267,43 @@ void Config::parse_cmd_line() {
             dce = true;
         } else if (argv[i] == "-const-prop"s) {
             const_prop = true;
+        } else if (argv[i] == "-ipsccp"s) {
+            ipsccp = true;
         } else if (argv[i] == "-func-inline"s) {
             func_inline = true;
+        } else if (argv[i] == "-func-spec"s) {
+            func_spec = true;
+        } else if (argv[i] == "-tre"s) {
+            tre = true;
+        } else if (argv[i] == "-memoize"s) {
+            memoize = true;
+        } else if (argv[i] == "-global-opt"s) {
+            global_opt = true;
+        } else if (argv[i] == "-sroa"s) {
+            sroa = true;
+        } else if (argv[i] == "-gvn"s) {
+            gvn = true;
+        } else if (argv[i] == "-rle"s) {
+            rle = true;
+        } else if (argv[i] == "-dse"s) {
+            dse = true;
+        } else if (argv[i] == "-licm"s) {
+            licm = true;
+        } else if (argv[i] == "-lsr"s) {
+            lsr = true;
+        } else if (argv[i] == "-rce"s) {
+            rce = true;
+        } else if (argv[i] == "-loop-version"s) {
+            loop_version = true;
+        } else if (argv[i] == "-unroll"s) {
+            unroll = true;
+        } else if (argv[i] == "-unroll-factor"s) {
+            if (i + 1 < argc && std::atoi(argv[i + 1]) > 0) {
+                unroll_factor = std::atoi(argv[i + 1]);
+                i += 1;
+            } else {
+                print_err("bad unroll factor");
+            }
         } else {
             if (input_file.empty()) {
                 input_file = argv[i];
@@ -136,9 +326,51 @@ void Config::check() {
     if (const_prop && not dce) {
         print_err("const-prop pass need dce pass");
     }
+    if (func_spec && not dce) {
+        print_err("function specialization pass need dce pass");
+    }
+    if (ipsccp && not dce) {
+        print_err("ipsccp pass need dce pass");
+    }
     if (func_inline && not dce) {
         print_err("function inline pass need dce pass");
     }
+    if (gvn && not dce) {
+        print_err("gvn pass need dce pass");
+    }
+    if (tre && not dce) {
+        print_err("tre pass need dce pass");
+    }
+    if (memoize && not dce) {
+        print_err("memoize pass need dce pass");
+    }
+    if (global_opt && not dce) {
+        print_err("global-opt pass need dce pass");
+    }
+    if (sroa && not dce) {
+        print_err("sroa pass need dce pass");
+    }
+    if (rle && not dce) {
+        print_err("rle pass need dce pass");
+    }
+    if (dse && not dce) {
+        print_err("dse pass need dce pass");
+    }
+    if (licm && not dce) {
+        print_err("licm pass need dce pass");
+    }
+    if (lsr && not dce) {
+        print_err("lsr pass need dce pass");
+    }
+    if (rce && not dce) {
+        print_err("rce pass need dce pass");
+    }
+    if (loop_version && not dce) {
+        print_err("loop-version pass need dce pass");
+    }
+    if (unroll && not dce) {
+        print_err("unroll pass need dce pass");
+    }
     if (output_file.empty()) {
         output_file = input_file.stem();
         if (emitllvm) {
@@ -150,7 +382,7 @@ void Config::check() {
 void Config::print_help() const {
     std::cout << "Usage: " << exe_name
               << " [-h|--help] [-o <target-file>] [-emit-llvm] [-S] [-dump-json]"
-                 "[-const-prop] [-dce]"
+                 "[-const-prop] [-ipsccp] [-dce] [-func-spec] [-tre] [-memoize] [-global-opt] [-sroa] [-gvn] [-rle] [-dse] [-licm] [-lsr] [-rce] [-loop-version] [-unroll] [-unroll-factor <n>] [-time-report <json-file>] [-mem-report]"
                  "<input-file>"
               << std::endl;
     exit(0);
@@ -83,7 +83,7 @@ ASTNode *AST::transform_node_iter(syntax_tree_node *n) {
     } else if (n->children_num == 6) {
       node->id = n->children[1]->name;
       int num = std::stoi(n->children[3]->name);
-      auto num_node = std::make_shared<ASTNum>();
+      auto num_node = std::shared_ptr<ASTNum>(new ASTNum());
       num_node->i_val = num;
       num_node->type = TYPE_INT;
       node->num = num_node;
@@ -0,0 +1,48 @@
+#include "mem_stats.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <vector>
+
+namespace mem_stats {
+
+namespace {
+
+std::vector<Counter *> &registry() {
+    static std::vector<Counter *> counters;
+    return counters;
+}
+
+} // namespace
+
+void *allocate(std::size_t size) { return ::operator new(size); }
+
+void deallocate(void *ptr) { ::operator delete(ptr); }
+
+Counter::Counter(std::string name) : name(std::move(name)) {
+    registry().push_back(this);
+}
+
+void print_report(std::ostream &os) {
+    if (not enabled()) {
+        os << "allocation counts need a build with -DCMINUSF_MEM_STATS=ON\n";
+        return;
+    }
+    auto counters = registry();
+    std::sort(counters.begin(), counters.end(),
+              [](Counter *lhs, Counter *rhs) { return lhs->name < rhs->name; });
+
+    os << std::left << std::setw(16) << "class" << std::right
+       << std::setw(12) << "allocs" << std::setw(12) << "live"
+       << std::setw(14) << "bytes" << std::setw(14) << "live bytes"
+       << std::setw(14) << "peak bytes" << "\n";
+    for (auto c : counters) {
+        os << std::left << std::setw(16) << c->name << std::right
+           << std::setw(12) << c->allocs << std::setw(12)
+           << c->allocs - c->frees << std::setw(14) << c->bytes
+           << std::setw(14) << c->live_bytes << std::setw(14)
+           << c->peak_live_bytes << "\n";
+    }
+}
+
+} // namespace mem_stats
@@ -0,0 +1,101 @@
+#include "timer.hpp"
+
+#include <cstdio>
+#include <iomanip>
+#include <sys/resource.h>
+
+namespace {
+
+void print_json_string(std::ostream &os, const std::string &str) {
+    os << '"';
+    for (unsigned char c : str) {
+        switch (c) {
+        case '"':
+            os << "\\\"";
+            break;
+        case '\\':
+            os << "\\\\";
+            break;
+        case '\n':
+            os << "\\n";
+            break;
+        case '\t':
+            os << "\\t";
+            break;
+        default:
+            if (c < 0x20) {
+                char buf[8];
+                std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+                os << buf;
+            } else {
+                os << c;
+            }
+        }
+    }
+    os << '"';
+}
+
+} // namespace
+
+PhaseTimer::Scope::Scope(PhaseTimer *timer, std::string name)
+    : timer_(timer), name_(std::move(name)) {
+    if (timer_)
+        start_ = std::chrono::steady_clock::now();
+}
+
+PhaseTimer::Scope::~Scope() {
+    if (not timer_)
+        return;
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start_;
+    timer_->record(std::move(name_), elapsed.count(), get_peak_rss_kb());
+}
+
+void PhaseTimer::record(std::string name, double seconds, long peak_rss_kb) {
+    phases_.push_back({std::move(name), seconds, peak_rss_kb});
+}
+
+long PhaseTimer::get_peak_rss_kb() {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+    return usage.ru_maxrss; // Linux 下单位为 KB
+}
+
+double PhaseTimer::get_total() const {
+    double total = 0;
+    for (auto &phase : phases_)
+        total += phase.seconds;
+    return total;
+}
+
+void PhaseTimer::print_json(std::ostream &os, const std::string &input) const {
+    os << "{\"input\": ";
+    print_json_string(os, input);
+    os << ", \"total\": " << get_total() << ", \"phases\": [";
+    for (size_t i = 0; i < phases_.size(); ++i) {
+        if (i != 0)
+            os << ", ";
+        os << "{\"name\": ";
+        print_json_string(os, phases_[i].name);
+        os << ", \"seconds\": " << phases_[i].seconds
+           << ", \"peak_rss_kb\": " << phases_[i].peak_rss_kb << "}";
+    }
+    os << "]}";
+}
+
+void PhaseTimer::print_table(std::ostream &os) const {
+    os << std::left << std::setw(16) << "phase" << std::right
+       << std::setw(12) << "seconds" << std::setw(16) << "peak RSS (KB)"
+       << std::setw(12) << "+KB" << "\n";
+    long last_rss = 0;
+    for (auto &phase : phases_) {
+        os << std::left << std::setw(16) << phase.name << std::right
+           << std::setw(12) << std::fixed << std::setprecision(4)
+           << phase.seconds << std::setw(16) << phase.peak_rss_kb
+           << std::setw(12) << phase.peak_rss_kb - last_rss << "\n";
+        last_rss = phase.peak_rss_kb;
+    }
+    os.unsetf(std::ios::fixed);
+    os << std::setprecision(6);
+}
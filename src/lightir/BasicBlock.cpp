@@ -4,6 +4,7 @@
 #include "IRprinter.hpp"
 #include "Module.hpp"
 
+#include <algorithm>
 #include <cassert>
 
 BasicBlock::BasicBlock(Module *m, const std::string &name = "",
@@ -13,6 +14,12 @@ BasicBlock::BasicBlock(Module *m, const std::string &name = "",
     parent_->add_basic_block(this);
 }
 
+BasicBlock::~BasicBlock() {
+    // drop incoming edges first, so that clearing the branches that still
+    // target this block does not touch the destroyed edge lists
+    drop_all_edges();
+}
+
 Module *BasicBlock::get_module() { return get_parent()->get_parent(); }
 void BasicBlock::erase_from_parent() { this->get_parent()->remove(this); }
 
@@ -38,11 +45,60 @@ Instruction *BasicBlock::get_terminator() {
 void BasicBlock::add_instruction(Instruction *instr) {
     assert(not is_terminated() && "Inserting instruction to terminated bb");
     instr_list_.push_back(instr);
+    attach_instr(instr);
+}
+
+void BasicBlock::attach_instr(Instruction *instr) {
+    instr->set_parent(this);
+    // a branch under construction adds its edges once its targets are known
+    if (not instr->is_br() or instr->get_num_operand() == 0)
+        return;
+    auto br = static_cast<BranchInst *>(instr);
+    for (unsigned i = 0; i < br->get_num_successors(); i++) {
+        if (auto succ = br->get_successor(i))
+            add_succ_edge(succ);
+    }
+}
+
+void BasicBlock::detach_instr(Instruction *instr) {
+    if (instr->is_br()) {
+        auto br = static_cast<BranchInst *>(instr);
+        for (unsigned i = 0; i < br->get_num_successors(); i++) {
+            if (auto succ = br->get_successor(i))
+                remove_succ_edge(succ);
+        }
+    }
+    instr->set_parent(nullptr);
+}
+
+void BasicBlock::add_succ_edge(BasicBlock *succ) {
+    succ_bbs_.push_back(succ);
+    succ->pre_bbs_.push_back(this);
+}
+
+void BasicBlock::remove_succ_edge(BasicBlock *succ) {
+    auto it = std::find(succ_bbs_.begin(), succ_bbs_.end(), succ);
+    if (it == succ_bbs_.end())
+        return;
+    // successors keep branch order, predecessors are unordered
+    succ_bbs_.erase(it);
+    auto &preds = succ->pre_bbs_;
+    auto pre_it = std::find(preds.begin(), preds.end(), this);
+    assert(pre_it != preds.end() && "CFG edge lists out of sync");
+    *pre_it = preds.back();
+    preds.pop_back();
+}
+
+void BasicBlock::drop_all_edges() {
+    while (not pre_bbs_.empty())
+        pre_bbs_.back()->remove_succ_edge(this);
+    while (not succ_bbs_.empty())
+        remove_succ_edge(succ_bbs_.back());
 }
 
 std::string BasicBlock::print() {
     std::string bb_ir;
-    bb_ir += this->get_name();
+    bb_ir += print_local_name(this);
     bb_ir += ":";
     // print prebb
     if (!this->get_pre_basic_blocks().empty()) {
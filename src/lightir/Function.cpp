@@ -3,7 +3,7 @@
 #include "Module.hpp"
 
 Function::Function(FunctionType *ty, const std::string &name, Module *parent)
-    : Value(ty, name), parent_(parent), seq_cnt_(0) {
+    : Value(ty, name), parent_(parent) {
     // num_args_ = ty->getNumParams();
     parent->add_function(this);
     // build args
@@ -34,48 +34,14 @@ Module *Function::get_parent() const { return parent_; }
 
 void Function::remove(BasicBlock *bb) {
     basic_blocks_.remove(bb);
-    for (auto pre : bb->get_pre_basic_blocks()) {
-        pre->remove_succ_basic_block(bb);
-    }
-    for (auto succ : bb->get_succ_basic_blocks()) {
-        succ->remove_pre_basic_block(bb);
-    }
+    bb->drop_all_edges();
 }
 
 void Function::add_basic_block(BasicBlock *bb) { basic_blocks_.push_back(bb); }
 
-void Function::set_instr_name() {
-    std::map<Value *, int> seq;
-    for (auto &arg : this->get_args()) {
-        if (seq.find(&arg) == seq.end()) {
-            auto seq_num = seq.size() + seq_cnt_;
-            if (arg.set_name("arg" + std::to_string(seq_num))) {
-                seq.insert({&arg, seq_num});
-            }
-        }
-    }
-    for (auto &bb1 : basic_blocks_) {
-        auto bb = &bb1;
-        if (seq.find(bb) == seq.end()) {
-            auto seq_num = seq.size() + seq_cnt_;
-            if (bb->set_name("label" + std::to_string(seq_num))) {
-                seq.insert({bb, seq_num});
-            }
-        }
-        for (auto &instr : bb->get_instructions()) {
-            if (!instr.is_void() && seq.find(&instr) == seq.end()) {
-                auto seq_num = seq.size() + seq_cnt_;
-                if (instr.set_name("op" + std::to_string(seq_num))) {
-                    seq.insert({&instr, seq_num});
-                }
-            }
-        }
-    }
-    seq_cnt_ += seq.size();
-}
-
 std::string Function::print() {
-    set_instr_name();
+    SlotTracker slots(this);
+    SlotScope scope(slots);
     std::string func_ir;
     if (this->is_declaration()) {
         func_ir += "declare ";
@@ -125,7 +91,7 @@ std::string Function::print() {
 std::string Argument::print() {
     std::string arg_ir;
     arg_ir += this->get_type()->print();
-    arg_ir += " %";
-    arg_ir += this->get_name();
+    arg_ir += " ";
+    arg_ir += print_as_op(this, false);
     return arg_ir;
 }
@@ -3,6 +3,64 @@
 #include <cassert>
 #include <type_traits>
 
+static const SlotTracker *active_slots = nullptr;
+
+SlotTracker::SlotTracker(Function *f) {
+    auto number = [&](const Value *v) {
+        if (not v->has_name())
+            slots_.try_emplace(v, slots_.size());
+    };
+    for (auto &arg : f->get_args())
+        number(&arg);
+    for (auto &bb : f->get_basic_blocks()) {
+        number(&bb);
+        for (auto &instr : bb.get_instructions()) {
+            if (not instr.is_void())
+                number(&instr);
+        }
+    }
+}
+
+std::string SlotTracker::get_local_name(const Value *v) const {
+    if (v->has_name())
+        return v->get_name();
+    auto it = slots_.find(v);
+    if (it == slots_.end())
+        return "<badref>";
+    std::string prefix = "op";
+    if (v->is<Argument>())
+        prefix = "arg";
+    else if (v->is<BasicBlock>())
+        prefix = "label";
+    return prefix + std::to_string(it->second);
+}
+
+SlotScope::SlotScope(const SlotTracker &slots) : prev_(active_slots) {
+    active_slots = &slots;
+}
+
+SlotScope::~SlotScope() { active_slots = prev_; }
+
+static Function *get_local_parent(Value *v) {
+    if (auto instr = dynamic_cast<Instruction *>(v))
+        return instr->get_parent() ? instr->get_function() : nullptr;
+    if (auto bb = dynamic_cast<BasicBlock *>(v))
+        return bb->get_parent();
+    if (auto arg = dynamic_cast<Argument *>(v))
+        return arg->get_parent();
+    return nullptr;
+}
+
+std::string print_local_name(Value *v) {
+    if (active_slots)
+        return active_slots->get_local_name(v);
+    if (v->has_name())
+        return v->get_name();
+    if (auto f = get_local_parent(v))
+        return SlotTracker(f).get_local_name(v);
+    return "<badref>";
+}
+
 std::string print_as_op(Value *v, bool print_ty) {
     std::string op_ir;
     if (print_ty) {
@@ -17,7 +75,7 @@ std::string print_as_op(Value *v, bool print_ty) {
     } else if (dynamic_cast<Constant *>(v)) {
         op_ir += v->print();
     } else {
-        op_ir += "%" + v->get_name();
+        op_ir += "%" + print_local_name(v);
     }
 
     return op_ir;
@@ -91,10 +149,9 @@ std::string print_instr_op_name(Instruction::OpID id) {
     assert(false && "Must be bug");
 }
 
-template <class BinInst> std::string print_binary_inst(const BinInst &inst) {
+template <class BinInst> std::string print_binary_inst(BinInst &inst) {
     std::string instr_ir;
-    instr_ir += "%";
-    instr_ir += inst.get_name();
+    instr_ir += print_as_op(&inst, false);
     instr_ir += " = ";
     instr_ir += inst.get_instr_op_name();
     instr_ir += " ";
@@ -112,7 +169,7 @@ template <class BinInst> std::string print_binary_inst(const BinInst &inst) {
 std::string IBinaryInst::print() { return print_binary_inst(*this); }
 std::string FBinaryInst::print() { return print_binary_inst(*this); }
 
-template <class CMP> std::string print_cmp_inst(const CMP &inst) {
+template <class CMP> std::string print_cmp_inst(CMP &inst) {
     std::string cmp_type;
     if (inst.is_cmp())
         cmp_type = "icmp";
@@ -121,8 +178,7 @@ template <class CMP> std::string print_cmp_inst(const CMP &inst) {
     else
         assert(false && "Unexpected case");
     std::string instr_ir;
-    instr_ir += "%";
-    instr_ir += inst.get_name();
+    instr_ir += print_as_op(&inst, false);
     instr_ir += " = " + cmp_type + " ";
     instr_ir += inst.get_instr_op_name();
     instr_ir += " ";
@@ -143,8 +199,7 @@ std::string FCmpInst::print() { return print_cmp_inst(*this); }
 std::string CallInst::print() {
     std::string instr_ir;
     if (!this->is_void()) {
-        instr_ir += "%";
-        instr_ir += this->get_name();
+        instr_ir += print_as_op(this, false);
         instr_ir += " = ";
     }
     instr_ir += get_instr_op_name();
@@ -198,8 +253,7 @@ std::string ReturnInst::print() {
 
 std::string GetElementPtrInst::print() {
     std::string instr_ir;
-    instr_ir += "%";
-    instr_ir += this->get_name();
+    instr_ir += print_as_op(this, false);
     instr_ir += " = ";
     instr_ir += get_instr_op_name();
     instr_ir += " ";
@@ -231,8 +285,7 @@ std::string StoreInst::print() {
 
 std::string LoadInst::print() {
     std::string instr_ir;
-    instr_ir += "%";
-    instr_ir += this->get_name();
+    instr_ir += print_as_op(this, false);
     instr_ir += " = ";
     instr_ir += get_instr_op_name();
     instr_ir += " ";
@@ -247,8 +300,7 @@ std::string LoadInst::print() {
 
 std::string AllocaInst::print() {
     std::string instr_ir;
-    instr_ir += "%";
-    instr_ir += this->get_name();
+    instr_ir += print_as_op(this, false);
     instr_ir += " = ";
     instr_ir += get_instr_op_name();
     instr_ir += " ";
@@ -258,8 +310,7 @@ std::string AllocaInst::print() {
 
 std::string ZextInst::print() {
     std::string instr_ir;
-    instr_ir += "%";
-    instr_ir += this->get_name();
+    instr_ir += print_as_op(this, false);
     instr_ir += " = ";
     instr_ir += get_instr_op_name();
     instr_ir += " ";
@@ -273,8 +324,7 @@ std::string ZextInst::print() {
 
 std::string FpToSiInst::print() {
     std::string instr_ir;
-    instr_ir += "%";
-    instr_ir += this->get_name();
+    instr_ir += print_as_op(this, false);
     instr_ir += " = ";
     instr_ir += get_instr_op_name();
     instr_ir += " ";
@@ -288,8 +338,7 @@ std::string FpToSiInst::print() {
 
 std::string SiToFpInst::print() {
     std::string instr_ir;
-    instr_ir += "%";
-    instr_ir += this->get_name();
+    instr_ir += print_as_op(this, false);
     instr_ir += " = ";
     instr_ir += get_instr_op_name();
     instr_ir += " ";
@@ -303,8 +352,7 @@ std::string SiToFpInst::print() {
 
 std::string PhiInst::print() {
     std::string instr_ir;
-    instr_ir += "%";
-    instr_ir += this->get_name();
+    instr_ir += print_as_op(this, false);
     instr_ir += " = ";
     instr_ir += get_instr_op_name();
     instr_ir += " ";
@@ -25,7 +25,7 @@ std::string Instruction::get_instr_op_name() const {
 }
 
 IBinaryInst::IBinaryInst(OpID id, Value *v1, Value *v2, BasicBlock *bb)
-    : BaseInst<IBinaryInst>(bb->get_module()->get_int32_type(), id, bb) {
+    : BaseInst<IBinaryInst>(v1->get_type(), id, bb) {
     assert(v1->get_type()->is_int32_type() && v2->get_type()->is_int32_type() &&
            "IBinaryInst operands are not both i32");
     add_operand(v1);
@@ -94,6 +94,38 @@ ICmpInst *ICmpInst::create_ne(Value *v1, Value *v2, BasicBlock *bb) {
     return create(ne, v1, v2, bb);
 }
 
+Instruction::OpID ICmpInst::get_swapped_predicate(OpID pred) {
+    switch (pred) {
+    case lt:
+        return gt;
+    case le:
+        return ge;
+    case gt:
+        return lt;
+    case ge:
+        return le;
+    default:
+        return pred;
+    }
+}
+
+Instruction::OpID ICmpInst::get_inverse_predicate(OpID pred) {
+    switch (pred) {
+    case lt:
+        return ge;
+    case le:
+        return gt;
+    case gt:
+        return le;
+    case ge:
+        return lt;
+    case eq:
+        return ne;
+    default:
+        return eq;
+    }
+}
+
 FCmpInst::FCmpInst(OpID id, Value *lhs, Value *rhs, BasicBlock *bb)
     : BaseInst<FCmpInst>(bb->get_module()->get_int1_type(), id, bb) {
     assert(lhs->get_type()->is_float_type() &&
@@ -123,7 +155,7 @@ FCmpInst *FCmpInst::create_fne(Value *v1, Value *v2, BasicBlock *bb) {
 }
 
 CallInst::CallInst(Function *func, std::vector<Value *> args, BasicBlock *bb)
-    : BaseInst<CallInst>(func->get_return_type(), call, bb) {
+    : BaseInst<CallInst>(func->get_return_type(), call, bb), func_(func) {
     assert(func->get_type()->is_function_type() && "Not a function");
     assert((func->get_num_of_args() == args.size()) && "Wrong number of args");
     add_operand(func);
@@ -150,37 +182,48 @@ BranchInst::BranchInst(Value *cond, BasicBlock *if_true, BasicBlock *if_false,
     if (cond == nullptr) { // conditionless jump
         assert(if_false == nullptr && "Given false-bb on conditionless jump");
         add_operand(if_true);
-        // prev/succ
-        if_true->add_pre_basic_block(bb);
-        bb->add_succ_basic_block(if_true);
     } else {
         assert(cond->get_type()->is_int1_type() &&
                "BranchInst condition is not i1");
         add_operand(cond);
         add_operand(if_true);
         add_operand(if_false);
-        // prev/succ
-        if_true->add_pre_basic_block(bb);
-        if_false->add_pre_basic_block(bb);
-        bb->add_succ_basic_block(if_true);
-        bb->add_succ_basic_block(if_false);
+    }
+    // prev/succ, the block got this branch before its targets were known
+    if (bb) {
+        for (unsigned i = 0; i < get_num_successors(); i++)
+            bb->add_succ_edge(get_successor(i));
     }
 }
 
 BranchInst::~BranchInst() {
-    std::list<BasicBlock *> succs;
-    if (is_cond_br()) {
-        succs.push_back(static_cast<BasicBlock *>(get_operand(1)));
-        succs.push_back(static_cast<BasicBlock *>(get_operand(2)));
-    } else {
-        succs.push_back(static_cast<BasicBlock *>(get_operand(0)));
+    auto bb = get_parent();
+    if (bb == nullptr)
+        return;
+    for (unsigned i = 0; i < get_num_successors(); i++) {
+        if (auto succ_bb = get_successor(i))
+            bb->remove_succ_edge(succ_bb);
     }
-    for (auto succ_bb : succs) {
-        if (succ_bb) {
-            succ_bb->remove_pre_basic_block(get_parent());
-            get_parent()->remove_succ_basic_block(succ_bb);
-        }
+}
+
+BasicBlock *BranchInst::get_successor(unsigned i) const {
+    return static_cast<BasicBlock *>(get_operand(is_cond_br() ? i + 1 : i));
+}
+
+void BranchInst::set_operand(unsigned i, Value *v) {
+    auto bb = get_parent();
+    bool is_target = not is_cond_br() or i != 0;
+    if (bb and is_target) {
+        // the old target may be a block under destruction, so find it by
+        // address instead of casting it
+        auto succs = bb->get_succ_basic_blocks();
+        auto old_it = std::find(succs.begin(), succs.end(), get_operand(i));
+        if (old_it != succs.end())
+            bb->remove_succ_edge(*old_it);
+        if (v)
+            bb->add_succ_edge(v->as<BasicBlock>());
     }
+    User::set_operand(i, v);
 }
 
 BranchInst *BranchInst::create_cond_br(Value *cond, BasicBlock *if_true,
@@ -261,7 +304,8 @@ GetElementPtrInst *GetElementPtrInst::create_gep(Value *ptr,
 }
 
 StoreInst::StoreInst(Value *val, Value *ptr, BasicBlock *bb)
-    : BaseInst<StoreInst>(bb->get_module()->get_void_type(), store, bb) {
+    : BaseInst<StoreInst>(ptr->get_type()->get_module()->get_void_type(), store,
+                          bb) {
     assert((ptr->get_type()->get_pointer_element_type() == val->get_type()) &&
            "StoreInst ptr is not a pointer to val type");
     add_operand(val);
@@ -376,6 +420,13 @@ Instruction *FCmpInst::clone(BasicBlock *prt) const  {
 
 
 
+// 被调函数以 operand 0 为准, 它可能已被改写 (例如改为调用特化的副本)
+Instruction *CallInst::clone(BasicBlock *prt) const {
+    auto func = static_cast<Function *>(get_operand(0));
+    return new CallInst(func, {get_operands().begin() + 1, get_operands().end()},
+                        prt);
+}
+
 Instruction *ReturnInst::clone(BasicBlock *prt) const  {
   return new ReturnInst(get_operand(0), prt);
 }
@@ -409,5 +460,8 @@ Instruction *PhiInst::clone(BasicBlock *prt) const  {
     for (unsigned i = 0; i < get_num_operand(); i += 2) {
         temp->add_phi_pair_operand(get_operand(i), get_operand(i + 1));
     }
+    // 与其他指令的 clone 一致, 插入到 prt 末尾
+    if (prt != nullptr)
+        prt->add_instruction(temp);
     return temp;
 }
\ No newline at end of file
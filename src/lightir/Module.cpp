@@ -26,27 +26,30 @@ PointerType *Module::get_float_ptr_type() {
 }
 
 PointerType *Module::get_pointer_type(Type *contained) {
-    if (pointer_map_.find(contained) == pointer_map_.end()) {
-        pointer_map_[contained] = std::make_unique<PointerType>(contained);
-    }
-    return pointer_map_[contained].get();
+    auto &ty = pointer_map_[contained];
+    if (not ty)
+        ty = std::make_unique<PointerType>(contained);
+    return ty.get();
 }
 
 ArrayType *Module::get_array_type(Type *contained, unsigned num_elements) {
-    if (array_map_.find({contained, num_elements}) == array_map_.end()) {
-        array_map_[{contained, num_elements}] =
-            std::make_unique<ArrayType>(contained, num_elements);
-    }
-    return array_map_[{contained, num_elements}].get();
+    auto &ty = array_map_[{contained, num_elements}];
+    if (not ty)
+        ty = std::make_unique<ArrayType>(contained, num_elements);
+    return ty.get();
 }
 
 FunctionType *Module::get_function_type(Type *retty,
-                                        std::vector<Type *> &args) {
-    if (not function_map_.count({retty, args})) {
-        function_map_[{retty, args}] =
-            std::make_unique<FunctionType>(retty, args);
-    }
-    return function_map_[{retty, args}].get();
+                                        llvm::ArrayRef<Type *> args) {
+    FunctionTypeKeyInfo::KeyTy key(retty, args);
+    auto it = function_map_.find_as(key);
+    if (it != function_map_.end())
+        return *it;
+    auto ty = function_types_
+                  .emplace_back(std::make_unique<FunctionType>(retty, args))
+                  .get();
+    function_map_.insert_as(ty, key);
+    return ty;
 }
 
 void Module::add_function(Function *f) { function_list_.push_back(f); }
@@ -58,15 +61,7 @@ llvm::ilist<GlobalVariable> &Module::get_global_variable() {
     return global_list_;
 }
 
-void Module::set_print_name() {
-    for (auto &func : this->get_functions()) {
-        func.set_instr_name();
-    }
-    return;
-}
-
 std::string Module::print() {
-    set_print_name();
     std::string module_ir;
     for (auto &global_val : this->global_list_) {
         module_ir += global_val.print();
@@ -3,6 +3,7 @@
 
 #include <array>
 #include <cassert>
+#include <llvm/ADT/Hashing.h>
 #include <stdexcept>
 
 Type::Type(TypeID tid, Module *m) {
@@ -115,7 +116,7 @@ IntegerType::IntegerType(unsigned num_bits, Module *m)
 
 unsigned IntegerType::get_num_bits() const { return num_bits_; }
 
-FunctionType::FunctionType(Type *result, std::vector<Type *> params)
+FunctionType::FunctionType(Type *result, llvm::ArrayRef<Type *> params)
     : Type(Type::FunctionTyID, nullptr) {
     assert(is_valid_return_type(result) && "Invalid return type for function!");
     result_ = result;
@@ -125,6 +126,7 @@ FunctionType::FunctionType(Type *result, std::vector<Type *> params)
                "Not a valid type for function argument!");
         args_.push_back(p);
     }
+    hash_ = hash(result, params);
 }
 
 bool FunctionType::is_valid_return_type(Type *ty) {
@@ -136,10 +138,15 @@ bool FunctionType::is_valid_argument_type(Type *ty) {
            ty->is_float_type();
 }
 
-FunctionType *FunctionType::get(Type *result, std::vector<Type *> params) {
+FunctionType *FunctionType::get(Type *result, llvm::ArrayRef<Type *> params) {
     return result->get_module()->get_function_type(result, params);
 }
 
+unsigned FunctionType::hash(Type *result, llvm::ArrayRef<Type *> params) {
+    return llvm::hash_combine(
+        result, llvm::hash_combine_range(params.begin(), params.end()));
+}
+
 unsigned FunctionType::get_num_of_args() const { return args_.size(); }
 
 Type *FunctionType::get_param_type(unsigned i) const { return args_[i]; }
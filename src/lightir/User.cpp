@@ -5,37 +5,40 @@
 void User::set_operand(unsigned i, Value *v) {
     assert(i < operands_.size() && "set_operand out of index");
     if (operands_[i]) { // old operand
-        operands_[i]->remove_use(this, i);
+        operands_[i]->remove_use(use_iters_[i]);
     }
     if (v) { // new operand
-        v->add_use(this, i);
+        use_iters_[i] = v->add_use(this, i);
     }
     operands_[i] = v;
 }
 
 void User::add_operand(Value *v) {
     assert(v != nullptr && "bad use: add_operand(nullptr)");
-    v->add_use(this, operands_.size());
+    use_iters_.push_back(v->add_use(this, operands_.size()));
     operands_.push_back(v);
 }
 
 void User::remove_all_operands() {
     for (unsigned i = 0; i != operands_.size(); ++i) {
         if (operands_[i]) {
-            operands_[i]->remove_use(this, i);
+            operands_[i]->remove_use(use_iters_[i]);
         }
     }
     operands_.clear();
+    use_iters_.clear();
 }
 
 void User::remove_operand(unsigned idx) {
     assert(idx < operands_.size() && "remove_operand out of index");
     // influence on other operands
     for (unsigned i = idx + 1; i < operands_.size(); ++i) {
-        operands_[i]->remove_use(this, i);
-        operands_[i]->add_use(this, i - 1);
+        if (operands_[i]) {
+            use_iters_[i]->arg_no_ = i - 1;
+        }
     }
     // remove the designated operand
-    operands_[idx]->remove_use(this, idx);
+    operands_[idx]->remove_use(use_iters_[idx]);
     operands_.erase(operands_.begin() + idx);
+    use_iters_.erase(use_iters_.begin() + idx);
 }
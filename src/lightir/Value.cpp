@@ -3,24 +3,45 @@
 #include "User.hpp"
 
 #include <cassert>
+#include <unordered_map>
 
-bool Value::set_name(std::string name) {
-    if (name_ == "") {
-        name_ = name;
-        return true;
-    }
-    return false;
+// Names of user-named values. Most values are unnamed temporaries, so keeping
+// the string out of Value saves memory on every instruction.
+static std::unordered_map<const Value *, std::string> &value_names() {
+    static auto *names = new std::unordered_map<const Value *, std::string>;
+    return *names;
+}
+
+Value::Value(Type *ty, const std::string &name) : type_(ty) {
+    set_name(name);
 }
 
-void Value::add_use(User *user, unsigned arg_no) {
-    use_list_.emplace_back(user, arg_no);
-};
+Value::~Value() {
+    replace_all_use_with(nullptr);
+    if (has_name_)
+        value_names().erase(this);
+}
 
-void Value::remove_use(User *user, unsigned arg_no) {
-    auto target_use = Use(user, arg_no);
-    use_list_.remove_if([&](const Use &use) { return use == target_use; });
+std::string Value::get_name() const {
+    if (not has_name_)
+        return "";
+    return value_names().at(this);
 }
 
+bool Value::set_name(std::string name) {
+    if (has_name_ or name.empty())
+        return false;
+    value_names().emplace(this, std::move(name));
+    has_name_ = true;
+    return true;
+}
+
+std::list<Use>::iterator Value::add_use(User *user, unsigned arg_no) {
+    return use_list_.emplace(use_list_.end(), user, arg_no);
+}
+
+void Value::remove_use(std::list<Use>::iterator use) { use_list_.erase(use); }
+
 void Value::replace_all_use_with(Value *new_val) {
     if (this == new_val)
         return;
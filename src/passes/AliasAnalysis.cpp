@@ -0,0 +1,199 @@
+#include "AliasAnalysis.hpp"
+#include "Constant.hpp"
+#include "Function.hpp"
+#include "GlobalVariable.hpp"
+
+#include <llvm/ADT/SmallVector.h>
+#include <utility>
+
+namespace {
+
+// 下标表示为 base + offset, 常量的 base 为空
+using Index = std::pair<Value *, long>;
+
+Index decompose_index(Value *idx) {
+    if (auto c = dynamic_cast<ConstantInt *>(idx))
+        return {nullptr, c->get_value()};
+    auto instr = dynamic_cast<IBinaryInst *>(idx);
+    if (instr and (instr->is_add() or instr->is_sub())) {
+        auto lhs = instr->get_operand(0);
+        auto rhs = instr->get_operand(1);
+        if (instr->is_add() and dynamic_cast<ConstantInt *>(lhs))
+            std::swap(lhs, rhs);
+        if (auto c = dynamic_cast<ConstantInt *>(rhs))
+            return {lhs, instr->is_sub() ? -long(c->get_value())
+                                         : long(c->get_value())};
+    }
+    return {idx, 0};
+}
+
+// ptr 相对基址 obj 的各级下标; 多层 gep 时返回 false
+bool get_indices(Value *ptr, Value *obj, llvm::SmallVectorImpl<Index> &indices) {
+    if (ptr == obj) {
+        // 指针参数本身即是下标为 0 的元素
+        if (dynamic_cast<Argument *>(obj))
+            indices.push_back({nullptr, 0});
+        return true;
+    }
+    auto gep = dynamic_cast<GetElementPtrInst *>(ptr);
+    if (gep == nullptr or gep->get_operand(0) != obj)
+        return false;
+    for (unsigned i = 1; i < gep->get_num_operand(); ++i)
+        indices.push_back(decompose_index(gep->get_operand(i)));
+    return true;
+}
+
+} // namespace
+
+void AliasAnalysis::run() {
+    func_info_->run();
+    compute_points_to();
+}
+
+void AliasAnalysis::compute_points_to() {
+    points_to_.clear();
+    unknown_args_.clear();
+    for (auto &f : m_->get_functions()) {
+        if (f.is_declaration())
+            continue;
+        bool direct_calls_only = true;
+        for (auto &use : f.get_use_list())
+            if (not dynamic_cast<CallInst *>(use.val_) or use.arg_no_ != 0)
+                direct_calls_only = false;
+        for (auto &arg : f.get_args()) {
+            if (not arg.get_type()->is_pointer_type())
+                continue;
+            points_to_[&arg];
+            if (not direct_calls_only)
+                unknown_args_.insert(&arg);
+        }
+    }
+
+    // 集合只会增大, 未知是最终状态
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (auto &f : m_->get_functions()) {
+            if (f.is_declaration())
+                continue;
+            for (auto &use : f.get_use_list()) {
+                auto call = dynamic_cast<CallInst *>(use.val_);
+                if (call == nullptr)
+                    continue;
+                for (auto &arg : f.get_args()) {
+                    if (not points_to_.count(&arg) or unknown_args_.count(&arg))
+                        continue;
+                    auto obj = get_underlying_object(
+                        call->get_operand(arg.get_arg_no() + 1));
+                    auto &objects = points_to_[&arg];
+                    auto caller_arg = dynamic_cast<Argument *>(obj);
+                    if (caller_arg and not unknown_args_.count(caller_arg)) {
+                        for (auto caller_obj : points_to_[caller_arg])
+                            changed |= objects.insert(caller_obj).second;
+                    } else if (is_identified_object(obj)) {
+                        changed |= objects.insert(obj).second;
+                    } else {
+                        unknown_args_.insert(&arg);
+                        changed = true;
+                    }
+                }
+            }
+        }
+    }
+}
+
+const AliasAnalysis::ObjectSet *
+AliasAnalysis::get_points_to(Argument *arg) const {
+    if (unknown_args_.count(arg))
+        return nullptr;
+    auto it = points_to_.find(arg);
+    return it != points_to_.end() ? &it->second : nullptr;
+}
+
+Value *AliasAnalysis::get_underlying_object(Value *ptr) {
+    while (auto gep = dynamic_cast<GetElementPtrInst *>(ptr))
+        ptr = gep->get_operand(0);
+    return ptr;
+}
+
+bool AliasAnalysis::is_identified_object(Value *obj) {
+    return dynamic_cast<GlobalVariable *>(obj) or
+           dynamic_cast<AllocaInst *>(obj);
+}
+
+bool AliasAnalysis::may_be_same_object(Value *obj1, Value *obj2) const {
+    if (obj1 == obj2)
+        return true;
+    if (is_identified_object(obj1) and is_identified_object(obj2))
+        return false;
+    // 数组参数不会指向被调函数的 alloca
+    if (dynamic_cast<AllocaInst *>(obj1) or dynamic_cast<AllocaInst *>(obj2))
+        return false;
+    auto arg1 = dynamic_cast<Argument *>(obj1);
+    auto arg2 = dynamic_cast<Argument *>(obj2);
+    if (arg2 and not arg1) {
+        std::swap(arg1, arg2);
+        std::swap(obj1, obj2);
+    }
+    if (arg1 == nullptr)
+        return true;
+    auto objects1 = get_points_to(arg1);
+    if (objects1 == nullptr)
+        return true;
+    if (arg2 == nullptr)
+        return not is_identified_object(obj2) or objects1->count(obj2);
+    auto objects2 = get_points_to(arg2);
+    if (objects2 == nullptr)
+        return true;
+    for (auto obj : *objects1)
+        if (objects2->count(obj))
+            return true;
+    return false;
+}
+
+AliasResult AliasAnalysis::alias(Value *ptr1, Value *ptr2) const {
+    if (ptr1 == ptr2)
+        return AliasResult::MustAlias;
+    auto obj1 = get_underlying_object(ptr1);
+    auto obj2 = get_underlying_object(ptr2);
+    if (obj1 != obj2)
+        return may_be_same_object(obj1, obj2) ? AliasResult::MayAlias
+                                              : AliasResult::NoAlias;
+
+    llvm::SmallVector<Index, 2> indices1, indices2;
+    if (not get_indices(ptr1, obj1, indices1) or
+        not get_indices(ptr2, obj2, indices2) or
+        indices1.size() != indices2.size())
+        return AliasResult::MayAlias;
+    // 任一级下标一定不同就不重叠, 全部相同才一定重叠
+    bool all_equal = true;
+    for (unsigned i = 0; i < indices1.size(); ++i) {
+        if (indices1[i].first != indices2[i].first) {
+            all_equal = false;
+            continue;
+        }
+        if (indices1[i].second != indices2[i].second)
+            return AliasResult::NoAlias;
+    }
+    return all_equal ? AliasResult::MustAlias : AliasResult::MayAlias;
+}
+
+bool AliasAnalysis::call_accesses(CallInst *call, Value *ptr,
+                                  bool is_write) const {
+    auto callee = call->get_operand(0)->as<Function>();
+    auto obj = get_underlying_object(ptr);
+    auto &summary = func_info_->get_summary(callee);
+    if (is_write ? summary.writes_unknown : summary.reads_unknown)
+        return true;
+    // 被调函数自己访问的全局变量
+    for (auto global : is_write ? summary.written_globals : summary.read_globals)
+        if (may_be_same_object(global, obj))
+            return true;
+    // 通过指针参数访问的实参; alloca 只能以这种方式被被调函数访问
+    auto &args = is_write ? summary.written_args : summary.read_args;
+    for (unsigned i = 0; i < args.size(); ++i)
+        if (args[i] and may_be_same_object(
+                            get_underlying_object(call->get_operand(i + 1)), obj))
+            return true;
+    return false;
+}
@@ -0,0 +1,106 @@
+#include "CallGraph.hpp"
+#include "Function.hpp"
+#include "logging.hpp"
+
+#include <algorithm>
+#include <functional>
+
+void CallGraph::run() {
+    external_node_ = std::make_unique<CallGraphNode>(nullptr);
+    nodes_.clear();
+    for (auto &f : m_->get_functions())
+        if (not f.is_declaration())
+            nodes_[&f] = std::make_unique<CallGraphNode>(&f);
+
+    for (auto &f : m_->get_functions()) {
+        if (f.is_declaration())
+            continue;
+        auto caller = get_node(&f);
+        for (auto &bb : f.get_basic_blocks()) {
+            for (auto &instr : bb.get_instructions()) {
+                if (not instr.is_call())
+                    continue;
+                auto call = static_cast<CallInst *>(&instr);
+                auto callee = get_node(call->get_operand(0)->as<Function>());
+                caller->calls_.push_back(call);
+                callee->call_sites_.push_back(call);
+                if (std::find(caller->callees_.begin(), caller->callees_.end(),
+                              callee) == caller->callees_.end()) {
+                    caller->callees_.push_back(callee);
+                    callee->callers_.push_back(caller);
+                }
+                if (callee == caller)
+                    caller->recursive_ = true;
+            }
+        }
+    }
+    compute_sccs();
+    LOG_INFO << "call graph found " << sccs_.size() << " SCCs";
+}
+
+CallGraphNode *CallGraph::get_node(Function *func) const {
+    if (func->is_declaration())
+        return external_node_.get();
+    auto it = nodes_.find(func);
+    return it != nodes_.end() ? it->second.get() : nullptr;
+}
+
+void CallGraph::compute_sccs() {
+    // Tarjan 算法: 分量在其中所有函数的 DFS 结束时产生, 被调者所在的
+    // 分量一定先于调用者
+    sccs_.clear();
+    llvm::DenseMap<CallGraphNode *, unsigned> index;
+    llvm::DenseMap<CallGraphNode *, unsigned> low_link;
+    llvm::DenseMap<CallGraphNode *, bool> on_stack;
+    std::vector<CallGraphNode *> stack;
+    unsigned next_index = 0;
+    std::function<void(CallGraphNode *)> visit = [&](CallGraphNode *node) {
+        index[node] = low_link[node] = next_index++;
+        stack.push_back(node);
+        on_stack[node] = true;
+        for (auto callee : node->get_callees()) {
+            if (callee->is_external())
+                continue;
+            if (not index.count(callee)) {
+                visit(callee);
+                low_link[node] = std::min(low_link[node], low_link[callee]);
+            } else if (on_stack[callee]) {
+                low_link[node] = std::min(low_link[node], index[callee]);
+            }
+        }
+        if (low_link[node] != index[node])
+            return;
+        std::vector<Function *> scc;
+        CallGraphNode *member;
+        do {
+            member = stack.back();
+            stack.pop_back();
+            on_stack[member] = false;
+            member->scc_id_ = sccs_.size();
+            scc.push_back(member->get_function());
+        } while (member != node);
+        if (scc.size() > 1)
+            for (auto func : scc)
+                get_node(func)->recursive_ = true;
+        sccs_.push_back(std::move(scc));
+    };
+    for (auto &f : m_->get_functions())
+        if (not f.is_declaration() and not index.count(get_node(&f)))
+            visit(get_node(&f));
+}
+
+void CallGraph::print() {
+    for (auto &scc : sccs_) {
+        for (auto func : scc) {
+            auto node = get_node(func);
+            std::string callees;
+            for (auto callee : node->get_callees())
+                callees += " " + (callee->is_external()
+                                      ? std::string("<external>")
+                                      : callee->get_function()->get_name());
+            LOG_INFO << "scc " << node->get_scc_id() << ": " << func->get_name()
+                     << (node->is_recursive() ? " (recursive)" : "")
+                     << " calls" << callees;
+        }
+    }
+}
@@ -3,21 +3,32 @@
 #include "Instruction.hpp"
 #include "logging.hpp"
 
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
 ConstantInt *ConstFolder::compute(Instruction::OpID op, ConstantInt *value1, ConstantInt *value2) {
     int c_value1 = value1->get_value();
     int c_value2 = value2->get_value();
+    // 与 LLVM 的 add/sub/mul 一样按补码回绕, 避免有符号溢出的未定义行为
+    uint32_t u_value1 = c_value1;
+    uint32_t u_value2 = c_value2;
 
     switch (op) {
     case Instruction::add:
-        return ConstantInt::get(c_value1 + c_value2, module_);
+        return ConstantInt::get(static_cast<int>(u_value1 + u_value2), module_);
         break;
     case Instruction::sub:
-        return ConstantInt::get(c_value1 - c_value2, module_);
+        return ConstantInt::get(static_cast<int>(u_value1 - u_value2), module_);
         break;
     case Instruction::mul:
-        return ConstantInt::get(c_value1 * c_value2, module_);
+        return ConstantInt::get(static_cast<int>(u_value1 * u_value2), module_);
         break;
     case Instruction::sdiv:
+        // 除以 0 与 INT_MIN / -1 在运行时是未定义的, 不折叠
+        if (c_value2 == 0 ||
+            (c_value1 == std::numeric_limits<int>::min() && c_value2 == -1))
+            return nullptr;
         return ConstantInt::get(static_cast<int>(c_value1 / c_value2), module_);
         break;
     case Instruction::eq:
@@ -44,9 +55,11 @@ ConstantInt *ConstFolder::compute(Instruction::OpID op, ConstantInt *value1, Con
     }
 }
 
-ConstantFP *ConstFolder::compute(Instruction::OpID op, ConstantFP *value1, ConstantFP *value2) {
+Constant *ConstFolder::compute(Instruction::OpID op, ConstantFP *value1, ConstantFP *value2) {
     float c_value1 = value1->get_value();
     float c_value2 = value2->get_value();
+    // 浮点比较被翻译为无序比较 (fcmp uge 等), 有 NaN 时结果为真
+    bool unordered = std::isnan(c_value1) || std::isnan(c_value2);
     switch (op) {
     case Instruction::fadd:
         return ConstantFP::get(c_value1 + c_value2, module_);
@@ -61,35 +74,38 @@ ConstantFP *ConstFolder::compute(Instruction::OpID op, ConstantFP *value1, Const
         return ConstantFP::get(c_value1 / c_value2, module_);
         break;
     case Instruction::feq:
-        return ConstantFP::get(c_value1 == c_value2, module_);
+        return ConstantInt::get(unordered || c_value1 == c_value2, module_);
         break;
     case Instruction::fne:
-        return ConstantFP::get(c_value1 != c_value2, module_);
+        return ConstantInt::get(unordered || c_value1 != c_value2, module_);
         break;
     case Instruction::fgt:
-        return ConstantFP::get(c_value1 > c_value2, module_);
+        return ConstantInt::get(unordered || c_value1 > c_value2, module_);
         break;
     case Instruction::fge:
-        return ConstantFP::get(c_value1 >= c_value2, module_);
+        return ConstantInt::get(unordered || c_value1 >= c_value2, module_);
         break;
     case Instruction::flt:
-        return ConstantFP::get(c_value1 < c_value2, module_);
+        return ConstantInt::get(unordered || c_value1 < c_value2, module_);
         break;
     case Instruction::fle:
-        return ConstantFP::get(c_value1 <= c_value2, module_);
+        return ConstantInt::get(unordered || c_value1 <= c_value2, module_);
         break;
     default:
         return nullptr;
         break;
     }
 }
-ConstantFP *ConstFolder::compute(Instruction::OpID op, ConstantInt *value1) {
+Constant *ConstFolder::compute(Instruction::OpID op, ConstantInt *value1) {
     int c_value1 = value1->get_value();
 
     switch (op) {
     case Instruction::sitofp:
         return ConstantFP::get((float) c_value1, module_);
         break;
+    case Instruction::zext:
+        return ConstantInt::get(c_value1 != 0 ? 1 : 0, module_);
+        break;
 
     default:
         return nullptr;
@@ -101,6 +117,9 @@ ConstantInt *ConstFolder::compute(Instruction::OpID op, ConstantFP *value1) {
     float c_value1 = value1->get_value();
     switch (op) {
     case Instruction::fptosi:
+        // 超出 int 范围 (包括 NaN) 的结果在运行时是 poison, 不折叠
+        if (!(c_value1 > -2147483904.0f && c_value1 < 2147483648.0f))
+            return nullptr;
         return ConstantInt::get(static_cast<int>(c_value1), module_);
         break;
 
@@ -110,6 +129,27 @@ ConstantInt *ConstFolder::compute(Instruction::OpID op, ConstantFP *value1) {
     }
 }
 
+Constant *ConstFolder::fold(Instruction *instr, Constant *value1, Constant *value2) {
+    auto op = instr->get_instr_type();
+    auto int1 = cast_constantint(value1);
+    auto int2 = cast_constantint(value2);
+    auto fp1 = cast_constantfp(value1);
+    auto fp2 = cast_constantfp(value2);
+
+    if (instr->isBinary() || instr->is_cmp() || instr->is_fcmp()) {
+        if (int1 && int2)
+            return compute(op, int1, int2);
+        if (fp1 && fp2)
+            return compute(op, fp1, fp2);
+        return nullptr;
+    }
+    if (instr->is_zext() || instr->is_si2fp())
+        return int1 ? compute(op, int1) : nullptr;
+    if (instr->is_fp2si())
+        return fp1 ? compute(op, fp1) : nullptr;
+    return nullptr;
+}
+
 ConstantFP *cast_constantfp(Value *value) {
     auto constant_fp_ptr = dynamic_cast<ConstantFP *>(value);
     if (constant_fp_ptr) {
@@ -126,91 +166,358 @@ ConstantInt *cast_constantint(Value *value) {
 }
 
 void ConstPropagation::run() {
+    if (interprocedural_) {
+        find_tracked_functions();
+        std::vector<Function *> funcs;
+        for (auto &func : m_->get_functions()) {
+            if (!func.is_declaration())
+                funcs.push_back(&func);
+        }
+        run_on_funcs(funcs);
+    } else {
+        for (auto &func : m_->get_functions()) {
+            if (func.is_declaration())
+                continue;
+            run_on_funcs({&func});
+        }
+    }
+    LOG_INFO << "const propagation folded " << folded_count_
+             << " instructions, rewrote " << branch_count_
+             << " branches and removed " << bb_count_ << " blocks";
+    if (interprocedural_)
+        LOG_INFO << "ipsccp tracked " << tracked_functions_.size()
+                 << " functions, folded " << arg_count_ << " arguments and "
+                 << call_count_ << " call results";
+}
+
+void ConstPropagation::find_tracked_functions() {
+    call_graph_ = std::make_unique<CallGraph>(m_);
+    call_graph_->run();
+    tracked_functions_.clear();
     for (auto &func : m_->get_functions()) {
+        if (func.is_declaration() || func.get_name() == "main")
+            continue;
+        // 函数除了作为直接调用的被调者之外还有其他使用时, 调用点不完全可知
+        auto node = call_graph_->get_node(&func);
+        if (node->get_call_sites().size() == func.get_use_list().size())
+            tracked_functions_.insert(&func);
+    }
+}
 
-        for (auto &bb : func.get_basic_blocks()) {
-            wait_delete.clear();
+void ConstPropagation::run_on_funcs(const std::vector<Function *> &funcs) {
+    lattice_.clear();
+    return_lattice_.clear();
+    executable_edges_.clear();
+    executable_bbs_.clear();
 
-            for (auto &instr : bb.get_instructions()) {
-                // clear glbalvar_def map
+    // 被跟踪的函数在调用点可执行时才可执行
+    for (auto func : funcs) {
+        if (tracked_functions_.count(func))
+            continue;
+        auto entry = func->get_entry_block();
+        executable_bbs_.insert(entry);
+        bb_work_list_.push_back(entry);
+    }
+    // 条件一直为 undef 的跳转会让后继永远不可达, 把条件视为 overdefined 后再求解
+    bool changed;
+    do {
+        solve();
+        changed = false;
+        for (auto func : funcs)
+            changed |= resolve_undef_branches(func);
+    } while (changed);
 
-                if (instr.is_add() || instr.is_sub() || instr.is_mul() || instr.is_div()) {
-                    auto value1 = cast_constantint(instr.get_operand(0));
-                    auto value2 = cast_constantint(instr.get_operand(1));
-                    if (value1 && value2) {
-                        auto fold_const = folder->compute(instr.get_instr_type(), value1, value2);
+    for (auto func : funcs) {
+        if (!executable_bbs_.count(func->get_entry_block()))
+            continue;
+        replace_constants(func);
+        rewrite_branches(func);
+        remove_dead_blocks(func);
+    }
+}
 
-                        instr.replace_all_use_with(fold_const);
-                        wait_delete.push_back(&instr);
-                    }
-                }
-                // TODO: fold other type of expression
-                throw std::runtime_error("Lab2: 你有一个TODO需要完成！");
-            }
-            globalvar_def.clear();
-            for (auto instr : wait_delete) {
-                bb.erase_instr(instr);
-            }
+void ConstPropagation::solve() {
+    while (!bb_work_list_.empty() || !instr_work_list_.empty()) {
+        // 新变为可执行的基本块, 其中所有指令都要求值一次
+        while (!bb_work_list_.empty()) {
+            auto bb = bb_work_list_.back();
+            bb_work_list_.pop_back();
+            for (auto &instr : bb->get_instructions())
+                visit(&instr);
+        }
+        // 格值发生变化的指令的使用者
+        while (!instr_work_list_.empty()) {
+            auto instr = instr_work_list_.back();
+            instr_work_list_.pop_back();
+            if (executable_bbs_.count(instr->get_parent()))
+                visit(instr);
         }
     }
+}
 
-    for (auto &func : m_->get_functions()) {
-        for (auto &bb : func.get_basic_blocks()) {
-            builder->set_insert_point(&bb);
-            // TODO: check if conditional branch's condition is constant
-            throw std::runtime_error("Lab2: 你有一个TODO需要完成！");
-        }
-        for (auto bb : delete_bb) {
-            clear_blocks_recs(bb);
+bool ConstPropagation::resolve_undef_branches(Function *func) {
+    bool changed = false;
+    for (auto &bb : func->get_basic_blocks()) {
+        if (!executable_bbs_.count(&bb) || !bb.is_terminated())
+            continue;
+        auto br = dynamic_cast<BranchInst *>(bb.get_terminator());
+        if (!br || !br->is_cond_br())
+            continue;
+        auto cond = dynamic_cast<Instruction *>(br->get_condition());
+        if (cond && get_lattice(cond).state == LatticeValue::undef) {
+            mark_overdefined(cond);
+            changed = true;
         }
-        delete_bb.clear();
     }
+    return changed;
+}
+
+ConstPropagation::LatticeValue ConstPropagation::get_lattice(Value *value) {
+    if (cast_constantint(value) || cast_constantfp(value))
+        return {LatticeValue::constant, static_cast<Constant *>(value)};
+    auto arg = dynamic_cast<Argument *>(value);
+    if (dynamic_cast<Instruction *>(value) ||
+        (arg && tracked_functions_.count(arg->get_parent()))) {
+        auto it = lattice_.find(value);
+        return it == lattice_.end() ? LatticeValue{} : it->second;
+    }
+    // 其余参数, 全局变量等
+    return {LatticeValue::overdefined, nullptr};
 }
 
-bool ConstPropagation::is_entry(BasicBlock *bb) {
-    // TODO
-    throw std::runtime_error("Lab2: 你有一个TODO需要完成！");
-    return false;
+void ConstPropagation::update(Value *value, LatticeValue new_value) {
+    auto &old_value = lattice_[value];
+    if (old_value == new_value || old_value.state == LatticeValue::overdefined)
+        return;
+    old_value = new_value;
+    for (auto &use : value->get_use_list()) {
+        if (auto user = dynamic_cast<Instruction *>(use.val_))
+            instr_work_list_.push_back(user);
+    }
 }
 
-void ConstPropagation::clear_blocks_recs(BasicBlock *start_bb) {
-    auto func = start_bb->get_parent();
-    if (func == nullptr) {
-        LOG(ERROR) << "basic block-" << start_bb->get_name() << " has no parent function";
+void ConstPropagation::merge(Value *value, LatticeValue new_value) {
+    auto old_value = get_lattice(value);
+    if (new_value.state == LatticeValue::undef || old_value == new_value)
+        return;
+    if (old_value.state == LatticeValue::undef)
+        update(value, new_value);
+    else
+        update(value, {LatticeValue::overdefined, nullptr});
+}
+
+void ConstPropagation::mark_overdefined(Instruction *instr) {
+    update(instr, {LatticeValue::overdefined, nullptr});
+}
+
+void ConstPropagation::mark_edge_executable(BasicBlock *from, BasicBlock *to) {
+    if (!executable_edges_.insert({from, to}).second)
+        return;
+    if (executable_bbs_.insert(to).second) {
+        bb_work_list_.push_back(to);
     } else {
-        auto prev_bb = start_bb->get_pre_basic_blocks();
-        // start_bb has no previous bb and is not the entry of parent function
-        if (prev_bb.size() == 0 && !is_entry(start_bb)) {
-            func->remove(start_bb);
-            auto succ_bb = start_bb->get_succ_basic_blocks();
-            for (auto each_succ_bb : succ_bb) {
-                std::vector<Instruction*> del_inst;
-                for (auto &instr1 : each_succ_bb->get_instructions()) {
-                    auto instr = &instr1;
-                    if (instr->is_phi()) {
-                        LOG(DEBUG) << "Find a PHI instruction in the sucess node of "
-                                      "useless branch";
-                        for (int i = 1; i < instr->get_num_operand(); i += 2) {
-                            if (instr->get_operand(i) == start_bb &&
-                                start_bb->get_pre_basic_blocks().size() <= 0) {
-                                LOG(DEBUG) << "remove unuseful phi branch in the index of " << i - 1
-                                           << " and " << i;
-
-                                instr->remove_operand(i - 1);
-                                instr->remove_operand(i - 1);
-                            }
-                        }
-                        int operands_num_phi = instr->get_num_operand();
-                        if (operands_num_phi == 2) {
-                            auto value = instr->get_operand(0);
-                            instr->replace_all_use_with(cast_constantint(value));
-                            del_inst.push_back(instr);
-                        }
-                    }
-                }
-                for(auto instr : del_inst) each_succ_bb->erase_instr(instr);
-                clear_blocks_recs(each_succ_bb);
+        // 块已经求值过, 只有 phi 会因为多了一条可执行的入边而改变
+        for (auto &instr : to->get_instructions()) {
+            if (!instr.is_phi())
+                break;
+            instr_work_list_.push_back(&instr);
+        }
+    }
+}
+
+void ConstPropagation::visit(Instruction *instr) {
+    if (instr->is_phi()) {
+        visit_phi(static_cast<PhiInst *>(instr));
+    } else if (instr->is_br()) {
+        visit_branch(static_cast<BranchInst *>(instr));
+    } else if (instr->isBinary() || instr->is_cmp() || instr->is_fcmp() ||
+               instr->is_zext() || instr->is_si2fp() || instr->is_fp2si()) {
+        visit_foldable(instr);
+    } else if (instr->is_call()) {
+        visit_call(static_cast<CallInst *>(instr));
+    } else if (instr->is_ret()) {
+        visit_return(static_cast<ReturnInst *>(instr));
+    } else if (!instr->is_void()) {
+        // load, alloca, getelementptr 的结果无法在编译期确定
+        mark_overdefined(instr);
+    }
+}
+
+void ConstPropagation::visit_phi(PhiInst *phi) {
+    if (get_lattice(phi).state == LatticeValue::overdefined)
+        return;
+    LatticeValue result;
+    for (auto [value, pre_bb] : phi->get_phi_pairs()) {
+        if (!is_edge_executable(pre_bb, phi->get_parent()))
+            continue;
+        auto incoming = get_lattice(value);
+        if (incoming.state == LatticeValue::undef)
+            continue;
+        if (incoming.state == LatticeValue::overdefined ||
+            (result.state == LatticeValue::constant && result.value != incoming.value)) {
+            result = {LatticeValue::overdefined, nullptr};
+            break;
+        }
+        result = incoming;
+    }
+    update(phi, result);
+}
+
+void ConstPropagation::visit_branch(BranchInst *br) {
+    auto bb = br->get_parent();
+    if (!br->is_cond_br()) {
+        mark_edge_executable(bb, br->get_successor(0));
+        return;
+    }
+    auto cond = get_lattice(br->get_condition());
+    if (cond.state == LatticeValue::undef)
+        return;
+    auto const_cond = cast_constantint(cond.value);
+    if (cond.state == LatticeValue::constant && const_cond) {
+        mark_edge_executable(bb, br->get_successor(const_cond->get_value() ? 0 : 1));
+        return;
+    }
+    mark_edge_executable(bb, br->get_successor(0));
+    mark_edge_executable(bb, br->get_successor(1));
+}
+
+void ConstPropagation::visit_foldable(Instruction *instr) {
+    if (get_lattice(instr).state == LatticeValue::overdefined)
+        return;
+    std::vector<Constant *> operands;
+    for (auto op : instr->get_operands()) {
+        auto value = get_lattice(op);
+        if (value.state == LatticeValue::overdefined) {
+            mark_overdefined(instr);
+            return;
+        }
+        if (value.state == LatticeValue::undef)
+            return;
+        operands.push_back(value.value);
+    }
+    auto folded = folder_.fold(instr, operands.at(0), operands.size() > 1 ? operands[1] : nullptr);
+    if (folded)
+        update(instr, {LatticeValue::constant, folded});
+    else
+        mark_overdefined(instr);
+}
+
+void ConstPropagation::visit_call(CallInst *call) {
+    auto callee = call->get_operand(0)->as<Function>();
+    if (!tracked_functions_.count(callee)) {
+        if (!call->is_void())
+            mark_overdefined(call);
+        return;
+    }
+    auto entry = callee->get_entry_block();
+    if (executable_bbs_.insert(entry).second)
+        bb_work_list_.push_back(entry);
+    for (auto &arg : callee->get_args())
+        merge(&arg, get_lattice(call->get_operand(arg.get_arg_no() + 1)));
+    if (!call->is_void()) {
+        auto it = return_lattice_.find(callee);
+        if (it != return_lattice_.end())
+            update(call, it->second);
+    }
+}
+
+void ConstPropagation::visit_return(ReturnInst *ret) {
+    auto func = ret->get_parent()->get_parent();
+    if (!tracked_functions_.count(func) || ret->is_void_ret())
+        return;
+    auto value = get_lattice(ret->get_operand(0));
+    auto &old_value = return_lattice_[func];
+    if (value.state == LatticeValue::undef || old_value == value ||
+        old_value.state == LatticeValue::overdefined)
+        return;
+    if (old_value.state == LatticeValue::undef)
+        old_value = value;
+    else
+        old_value = {LatticeValue::overdefined, nullptr};
+    // 所有调用点都要重新取返回值
+    for (auto call : call_graph_->get_node(func)->get_call_sites())
+        instr_work_list_.push_back(call);
+}
+
+void ConstPropagation::replace_constants(Function *func) {
+    if (tracked_functions_.count(func)) {
+        for (auto &arg : func->get_args()) {
+            auto value = get_lattice(&arg);
+            if (value.state != LatticeValue::constant)
+                continue;
+            arg.replace_all_use_with(value.value);
+            ++arg_count_;
+        }
+    }
+    for (auto &bb : func->get_basic_blocks()) {
+        if (!executable_bbs_.count(&bb))
+            continue;
+        std::vector<Instruction *> wait_delete;
+        for (auto &instr : bb.get_instructions()) {
+            auto value = get_lattice(&instr);
+            if (value.state != LatticeValue::constant || instr.is_void())
+                continue;
+            instr.replace_all_use_with(value.value);
+            // 调用可能有副作用, 只替换它的结果
+            if (instr.is_call()) {
+                ++call_count_;
+                continue;
             }
+            wait_delete.push_back(&instr);
         }
+        for (auto instr : wait_delete)
+            bb.erase_instr(instr);
+        folded_count_ += wait_delete.size();
+    }
+}
+
+void ConstPropagation::rewrite_branches(Function *func) {
+    for (auto &bb : func->get_basic_blocks()) {
+        if (!executable_bbs_.count(&bb) || !bb.is_terminated())
+            continue;
+        auto br = dynamic_cast<BranchInst *>(bb.get_terminator());
+        if (!br || !br->is_cond_br())
+            continue;
+        auto true_bb = br->get_successor(0);
+        auto false_bb = br->get_successor(1);
+        bool true_live = is_edge_executable(&bb, true_bb);
+        bool false_live = is_edge_executable(&bb, false_bb);
+        if (true_live == false_live)
+            continue;
+        auto live_bb = true_live ? true_bb : false_bb;
+        auto dead_bb = true_live ? false_bb : true_bb;
+        // 不再经过的那条边对应的 phi 来源也要删掉
+        for (auto &instr : dead_bb->get_instructions()) {
+            if (!instr.is_phi())
+                break;
+            static_cast<PhiInst *>(&instr)->remove_phi_operand(&bb);
+        }
+        bb.erase_instr(br);
+        BranchInst::create_br(live_bb, &bb);
+        ++branch_count_;
+    }
+}
+
+void ConstPropagation::remove_dead_blocks(Function *func) {
+    std::vector<BasicBlock *> dead_bbs;
+    for (auto &bb : func->get_basic_blocks()) {
+        if (!executable_bbs_.count(&bb))
+            dead_bbs.push_back(&bb);
+    }
+    for (auto bb : dead_bbs) {
+        for (auto succ : bb->get_succ_basic_blocks()) {
+            if (!executable_bbs_.count(succ))
+                continue;
+            for (auto &instr : succ->get_instructions()) {
+                if (!instr.is_phi())
+                    break;
+                static_cast<PhiInst *>(&instr)->remove_phi_operand(bb);
+            }
+        }
+    }
+    for (auto bb : dead_bbs) {
+        bb->erase_from_parent();
+        delete bb;
     }
+    bb_count_ += dead_bbs.size();
 }
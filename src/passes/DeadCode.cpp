@@ -8,7 +8,7 @@
 #include <memory>
 
 void DeadCode::run() {
-    // 虽然当前实现没有用到FuncInfo的纯函数信息，但让它先跑一遍
+    // is_critical 依据 FuncInfo 的摘要判断调用是否可以删除
     func_info->run();
 
     bool changed;
@@ -80,6 +80,30 @@ void DeadCode::mark(Function *func) {
         work_list.pop_front();
         mark(cur);
     }
+
+    // 结果没有被使用的调用才需要判断是否可能抛出异常, 可能抛出的保留
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (auto &bb : func->get_basic_blocks()) {
+            for (auto &ins_ref : bb.get_instructions()) {
+                auto *inst = &ins_ref;
+                if (!inst->is_call() || marked[inst])
+                    continue;
+                auto *callee = dynamic_cast<Function *>(inst->get_operand(0));
+                if (callee && func_info->may_raise(callee)) {
+                    marked[inst] = true;
+                    work_list.push_back(inst);
+                    changed = true;
+                }
+            }
+        }
+        while (!work_list.empty()) {
+            auto *cur = work_list.front();
+            work_list.pop_front();
+            mark(cur);
+        }
+    }
 }
 
 void DeadCode::mark(Instruction *ins) {
@@ -148,11 +172,14 @@ bool DeadCode::is_critical(Instruction *ins) {
         auto *call = static_cast<CallInst *>(ins);
         auto *callee = dynamic_cast<Function *>(call->get_operand(0));
 
-        // 如果知道这是一个纯函数（FuncInfo 分析得到），
+        // 如果知道这个函数不写内存、也没有 I/O（FuncInfo 分析得到），
         // 那调用本身没有副作用，只要返回值没人用就可以删。
-        // 因此只有“非纯函数调用”被视为关键。
-        if (callee && func_info->is_pure_function(callee)) {
-            return false;
+        // 因此只有可能写内存或有 I/O 的调用被视为关键。
+        // 是否可能抛出异常的计算较慢，留到 mark 中只对未被使用的调用判断。
+        if (callee) {
+            auto &summary = func_info->get_summary(callee);
+            if (!summary.calls_io && !summary.may_write())
+                return false;
         }
         return true;
     }
@@ -0,0 +1,155 @@
+#include "DeadStoreElim.hpp"
+#include "Function.hpp"
+#include "GlobalVariable.hpp"
+#include "logging.hpp"
+
+#include <algorithm>
+
+namespace {
+
+// ptr 的所有使用都是 store 的地址, 或是只这样使用的 gep
+bool only_stored_to(Value *ptr) {
+    for (auto &use : ptr->get_use_list()) {
+        auto store = dynamic_cast<StoreInst *>(use.val_);
+        if (store and use.arg_no_ == 1)
+            continue;
+        auto gep = dynamic_cast<GetElementPtrInst *>(use.val_);
+        if (gep and use.arg_no_ == 0 and only_stored_to(gep))
+            continue;
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+void DeadStoreElim::run() {
+    alias_analysis_ = std::make_unique<AliasAnalysis>(m_);
+    alias_analysis_->run();
+    find_write_only_globals();
+    for (auto &f : m_->get_functions()) {
+        if (f.is_declaration())
+            continue;
+        run_on_func(&f);
+    }
+    LOG_INFO << "dead store elimination removed " << overwritten_count_
+             << " overwritten stores and " << unread_count_
+             << " stores never read";
+}
+
+void DeadStoreElim::find_write_only_globals() {
+    write_only_globals_.clear();
+    for (auto &global : m_->get_global_variable())
+        if (only_stored_to(&global))
+            write_only_globals_.insert(&global);
+}
+
+void DeadStoreElim::run_on_func(Function *func) {
+    dead_stores_.clear();
+    for (auto &bb : func->get_basic_blocks()) {
+        for (auto &instr : bb.get_instructions()) {
+            if (not instr.is_store())
+                continue;
+            auto store = static_cast<StoreInst *>(&instr);
+            auto obj = AliasAnalysis::get_underlying_object(store->get_lval());
+            if (write_only_globals_.count(obj) and dead_stores_.insert(store).second)
+                ++unread_count_;
+        }
+        find_overwritten_stores(&bb);
+    }
+    find_unread_local_stores(func);
+    for (auto store : dead_stores_)
+        store->get_parent()->erase_instr(store);
+}
+
+bool DeadStoreElim::may_read(Instruction *instr, Value *ptr) {
+    if (instr->is_load())
+        return alias_analysis_->may_alias(
+            static_cast<LoadInst *>(instr)->get_lval(), ptr);
+    if (instr->is_call())
+        return alias_analysis_->call_may_read(static_cast<CallInst *>(instr),
+                                                ptr);
+    return false;
+}
+
+void DeadStoreElim::find_overwritten_stores(BasicBlock *bb) {
+    // 逆序扫描, 记录之后写入且尚未被读的地址
+    std::vector<Value *> overwritten;
+    auto &instrs = bb->get_instructions();
+    for (auto it = instrs.rbegin(); it != instrs.rend(); ++it) {
+        auto instr = &*it;
+        if (instr->is_store()) {
+            auto store = static_cast<StoreInst *>(instr);
+            auto ptr = store->get_lval();
+            if (std::any_of(overwritten.begin(), overwritten.end(),
+                            [&](Value *later) {
+                                return alias_analysis_->must_alias(later, ptr);
+                            })) {
+                if (dead_stores_.insert(store).second)
+                    ++overwritten_count_;
+                continue;
+            }
+            overwritten.push_back(ptr);
+            continue;
+        }
+        overwritten.erase(std::remove_if(overwritten.begin(), overwritten.end(),
+                                         [&](Value *later) {
+                                             return may_read(instr, later);
+                                         }),
+                          overwritten.end());
+    }
+}
+
+void DeadStoreElim::find_unread_local_stores(Function *func) {
+    // 按基址 alloca 收集 store
+    llvm::DenseMap<Value *, std::vector<StoreInst *>> local_stores;
+    for (auto &bb : func->get_basic_blocks()) {
+        for (auto &instr : bb.get_instructions()) {
+            if (not instr.is_store())
+                continue;
+            auto store = static_cast<StoreInst *>(&instr);
+            auto obj = AliasAnalysis::get_underlying_object(store->get_lval());
+            if (dynamic_cast<AllocaInst *>(obj) and not dead_stores_.count(store))
+                local_stores[obj].push_back(store);
+        }
+    }
+
+    for (auto &[obj, stores] : local_stores) {
+        // 含有对 obj 的读的块, 以及能到达它们的块
+        llvm::SmallPtrSet<BasicBlock *, 16> reach_read;
+        std::vector<BasicBlock *> work_list;
+        for (auto &bb : func->get_basic_blocks()) {
+            for (auto &instr : bb.get_instructions()) {
+                if (may_read(&instr, obj)) {
+                    if (reach_read.insert(&bb).second)
+                        work_list.push_back(&bb);
+                    break;
+                }
+            }
+        }
+        while (not work_list.empty()) {
+            auto bb = work_list.back();
+            work_list.pop_back();
+            for (auto pred : bb->get_pre_basic_blocks())
+                if (reach_read.insert(pred).second)
+                    work_list.push_back(pred);
+        }
+
+        for (auto store : stores) {
+            auto bb = store->get_parent();
+            auto succs = bb->get_succ_basic_blocks();
+            if (std::any_of(succs.begin(), succs.end(), [&](BasicBlock *succ) {
+                    return reach_read.count(succ);
+                }))
+                continue;
+            auto &instrs = bb->get_instructions();
+            auto it = std::next(store->getIterator());
+            if (std::any_of(it, instrs.end(), [&](Instruction &instr) {
+                    return may_read(&instr, store->get_lval());
+                }))
+                continue;
+            dead_stores_.insert(store);
+            ++unread_count_;
+        }
+    }
+}
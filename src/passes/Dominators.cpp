@@ -1,5 +1,6 @@
 #include "Dominators.hpp"
 #include "Function.hpp"
+#include "IRprinter.hpp"
 #include <fstream>
 #include <vector>
 
@@ -15,11 +16,15 @@ void Dominators::run() {
 void Dominators::run_on_func(Function *f) {
     dom_post_order_.clear();
     dom_dfs_order_.clear();
+    // 逆后序只在一个函数内有意义, 不清空的话后面的函数会重复遍历前面所有函数的块
+    post_order_vec_.clear();
+    post_order_.clear();
+    // 用赋值而不是 insert: 重新计算时 (或者块的地址被复用时) 覆盖旧的结果
     for(auto &bb1 : f->get_basic_blocks()) {
         auto bb = &bb1;
-        idom_.insert({bb, nullptr});
-        dom_frontier_.insert({bb, {}});
-        dom_tree_succ_blocks_.insert({bb, {}});
+        idom_[bb] = nullptr;
+        dom_frontier_[bb].clear();
+        dom_tree_succ_blocks_[bb].clear();
     }
     create_reverse_post_order(f);
     create_idom(f);
@@ -69,14 +74,12 @@ void Dominators::create_idom(Function *f) {
                 continue;
             if (bb->get_pre_basic_blocks().empty())
                 continue;
-            BasicBlock *first_pred = bb->get_pre_basic_blocks().front();
-            BasicBlock *new_idom = first_pred;
+            // 从已经处理过的前驱开始求交, 不可达的前驱不参与
+            BasicBlock *new_idom = nullptr;
             for (auto &pred : bb->get_pre_basic_blocks()) {
-                if (pred == first_pred)
+                if (get_idom(pred) == nullptr)
                     continue;
-                if (get_idom(pred) != nullptr) {
-                    new_idom = intersect(pred, new_idom);
-                }
+                new_idom = new_idom ? intersect(pred, new_idom) : pred;
             }
             if (new_idom != get_idom(bb)) {
                 changed = true;
@@ -90,8 +93,10 @@ void Dominators::create_dominance_frontier(Function *f) {
     // 分析得到 f 中各个基本块的支配边界集合
     for (auto &bb1 : f->get_basic_blocks()) {
         auto bb = &bb1;
-        if (bb->get_pre_basic_blocks().size() >= 2) {
+        if (bb->get_pre_basic_blocks().size() >= 2 && get_idom(bb) != nullptr) {
             for (auto &pred : bb->get_pre_basic_blocks()) {
+                if (get_idom(pred) == nullptr)
+                    continue;
                 auto runner = pred;
                 while (runner != get_idom(bb)) {
                     dom_frontier_[runner].insert(bb);
@@ -130,16 +135,11 @@ void Dominators::create_dom_dfs_order(Function *f) {
 }
 
 void Dominators::print_idom(Function *f) {
-    f->get_parent()->set_print_name();
-    int counter = 0;
+    SlotTracker slots(f);
     std::map<BasicBlock *, std::string> bb_id;
     for (auto &bb1 : f->get_basic_blocks()) {
         auto bb = &bb1;
-        if (bb->get_name().empty())
-            bb_id[bb] = "bb" + std::to_string(counter);
-        else
-            bb_id[bb] = bb->get_name();
-        counter++;
+        bb_id[bb] = slots.get_local_name(bb);
     }
     printf("Immediate dominance of function %s:\n", f->get_name().c_str());
     for (auto &bb1 : f->get_basic_blocks()) {
@@ -156,16 +156,11 @@ void Dominators::print_idom(Function *f) {
 }
 
 void Dominators::print_dominance_frontier(Function *f) {
-    f->get_parent()->set_print_name();
-    int counter = 0;
+    SlotTracker slots(f);
     std::map<BasicBlock *, std::string> bb_id;
     for (auto &bb1 : f->get_basic_blocks()) {
         auto bb = &bb1;
-        if (bb->get_name().empty())
-            bb_id[bb] = "bb" + std::to_string(counter);
-        else
-            bb_id[bb] = bb->get_name();
-        counter++;
+        bb_id[bb] = slots.get_local_name(bb);
     }
     printf("Dominance Frontier of function %s:\n", f->get_name().c_str());
     for (auto &bb1 : f->get_basic_blocks()) {
@@ -191,9 +186,9 @@ void Dominators::print_dominance_frontier(Function *f) {
 
 void Dominators::dump_cfg(Function *f)
 {
-    f->get_parent()->set_print_name();
     if(f->is_declaration())
         return;
+    SlotTracker slots(f);
     std::vector<std::string> edge_set;
     bool has_edges = false;
     for (auto &bb : f->get_basic_blocks()) {
@@ -201,14 +196,14 @@ void Dominators::dump_cfg(Function *f)
         if(!succ_blocks.empty())
             has_edges = true;
         for (auto succ : succ_blocks) {
-            edge_set.push_back('\t' + bb.get_name() + "->" + succ->get_name() + ";\n");
+            edge_set.push_back('\t' + slots.get_local_name(&bb) + "->" + slots.get_local_name(succ) + ";\n");
         }
     }
     std::string digraph = "digraph G {\n";
     if (!has_edges && !f->get_basic_blocks().empty()) {
         // 如果没有边且至少有一个基本块，添加一个自环以显示唯一的基本块
         auto &bb = f->get_basic_blocks().front();
-        digraph += '\t' + bb.get_name() + ";\n";
+        digraph += '\t' + slots.get_local_name(&bb) + ";\n";
     } else {
         for (auto &edge : edge_set) {
             digraph += edge;
@@ -225,16 +220,16 @@ void Dominators::dump_cfg(Function *f)
 
 void Dominators::dump_dominator_tree(Function *f)
 {
-    f->get_parent()->set_print_name();
     if(f->is_declaration())
         return;
+    SlotTracker slots(f);
 
     std::vector<std::string> edge_set;
     bool has_edges = false; // 用于检查是否有边存在
 
     for (auto &b : f->get_basic_blocks()) {
         if (idom_.find(&b) != idom_.end() && idom_[&b] != &b) {
-            edge_set.push_back('\t' + idom_[&b]->get_name() + "->" + b.get_name() + ";\n");
+            edge_set.push_back('\t' + slots.get_local_name(idom_[&b]) + "->" + slots.get_local_name(&b) + ";\n");
             has_edges = true; // 如果存在支配边，标记为 true
         }
     }
@@ -244,7 +239,7 @@ void Dominators::dump_dominator_tree(Function *f)
     if (!has_edges && !f->get_basic_blocks().empty()) {
         // 如果没有边且至少有一个基本块，直接添加该块以显示它
         auto &b = f->get_basic_blocks().front();
-        digraph += '\t' + b.get_name() + ";\n";
+        digraph += '\t' + slots.get_local_name(&b) + ";\n";
     } else {
         for (auto &edge : edge_set) {
             digraph += edge;
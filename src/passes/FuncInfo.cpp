@@ -1,110 +1,265 @@
 #include "FuncInfo.hpp"
 #include "Function.hpp"
 
-void FuncInfo::run() {
-    for (auto &f : m_->get_functions()) {
-        auto func = &f;
-        trivial_mark(func);
-        if (not is_pure[func])
-            worklist.push_back(func);
+#include <algorithm>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// 摘要只会增大, 用各部分的大小之和判断是否变化
+size_t get_weight(const FuncInfo::Summary &summary) {
+    return summary.read_globals.size() + summary.written_globals.size() +
+           std::count(summary.read_args.begin(), summary.read_args.end(), true) +
+           std::count(summary.written_args.begin(), summary.written_args.end(),
+                      true) +
+           summary.reads_unknown + summary.writes_unknown + summary.calls_io +
+           summary.may_raise + summary.may_not_return;
+}
+
+// CFG 中是否有环 (从入口可达的回边)
+bool has_cycle(Function *func) {
+    enum Color { white, gray, black };
+    std::unordered_map<BasicBlock *, Color> color;
+    // 迭代的 DFS: (块, 下一个要访问的后继的序号)
+    std::vector<std::pair<BasicBlock *, size_t>> stack;
+    stack.emplace_back(func->get_entry_block(), 0);
+    color[func->get_entry_block()] = gray;
+    while (not stack.empty()) {
+        auto &[bb, next] = stack.back();
+        auto succs = bb->get_succ_basic_blocks();
+        if (next == succs.size()) {
+            color[bb] = black;
+            stack.pop_back();
+            continue;
+        }
+        auto succ = succs[next++];
+        auto c = color[succ];
+        if (c == gray)
+            return true;
+        if (c == white) {
+            color[succ] = gray;
+            stack.emplace_back(succ, 0);
+        }
     }
-    while (worklist.empty() == false) {
-        auto now = worklist.front();
-        worklist.pop_front();
-        process(now);
+    return false;
+}
+
+} // namespace
+
+bool FuncInfo::Summary::may_read() const {
+    return reads_unknown or not read_globals.empty() or
+           std::find(read_args.begin(), read_args.end(), true) !=
+               read_args.end();
+}
+
+bool FuncInfo::Summary::may_write() const {
+    return writes_unknown or not written_globals.empty() or
+           std::find(written_args.begin(), written_args.end(), true) !=
+               written_args.end();
+}
+
+void FuncInfo::run() {
+    unknown_summary_.reads_unknown = true;
+    unknown_summary_.writes_unknown = true;
+    unknown_summary_.calls_io = true;
+    unknown_summary_.may_raise = true;
+    unknown_summary_.may_not_return = true;
+    summaries_.clear();
+    call_graph_ = std::make_unique<CallGraph>(m_);
+    call_graph_->run();
+    may_raise_.clear();
+
+    for (auto &f : m_->get_functions())
+        compute_local(&f);
+    // 递归时同一分量中的函数互相依赖, 整体重复到不动点
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (auto &scc : call_graph_->get_sccs())
+            for (auto func : scc)
+                changed |= merge_callees(func);
     }
     log();
 }
 
 void FuncInfo::log() {
-    for (auto it : is_pure) {
-        LOG_INFO << it.first->get_name() << " is pure? " << it.second;
+    for (auto &[func, summary] : summaries_) {
+        LOG_INFO << func->get_name() << " reads " << summary.read_globals.size()
+                 << " globals, writes " << summary.written_globals.size()
+                 << " globals, may read? " << summary.may_read()
+                 << ", may write? " << summary.may_write() << ", calls io? "
+                 << summary.calls_io << ", may raise? " << summary.may_raise
+                 << ", may not return? "
+                 << summary.may_not_return;
     }
 }
 
-// 有 store 操作的函数非纯函数来处理
-void FuncInfo::trivial_mark(Function *func) {
-    if (func->is_declaration() or func->get_name() == "main") {
-        is_pure[func] = false;
-        return;
-    }
-    // 只要传入数组，都作为非纯函数处理
-    for (auto it = func->get_function_type()->param_begin();
-         it != func->get_function_type()->param_end(); ++it) {
-        auto arg_type = *it;
-        if (arg_type->is_integer_type() == false and
-            arg_type->is_float_type() == false) {
-            is_pure[func] = false;
-            return;
+const FuncInfo::Summary &FuncInfo::get_summary(Function *func) const {
+    auto it = summaries_.find(func);
+    return it != summaries_.end() ? it->second : unknown_summary_;
+}
+
+bool FuncInfo::is_pure_function(Function *func) {
+    auto &summary = get_summary(func);
+    return not summary.calls_io and not summary.may_read() and
+           not summary.may_write() and not may_raise(func);
+}
+
+bool FuncInfo::is_read_only_function(Function *func) {
+    auto &summary = get_summary(func);
+    return not summary.calls_io and not summary.may_write() and
+           not may_raise(func);
+}
+
+bool FuncInfo::may_raise(Function *func) {
+    if (not get_summary(func).may_raise)
+        return false;
+    if (func->is_declaration())
+        return true;
+    auto it = may_raise_.find(func);
+    if (it != may_raise_.end())
+        return it->second;
+    // 同一分量中的函数互相调用, 只要有一个可能抛出就都视为可能抛出
+    auto node = call_graph_->get_node(func);
+    auto &scc = call_graph_->get_sccs()[node->get_scc_id()];
+    bool result = false;
+    for (auto f : scc) {
+        if (result)
+            break;
+        if (has_live_check(f)) {
+            result = true;
+            break;
         }
-    }
-    for (auto &bb : func->get_basic_blocks())
-        for (auto &inst : bb.get_instructions()) {
-            if (is_side_effect_inst(&inst)) {
-                is_pure[func] = false;
-                return;
+        for (auto call : call_graph_->get_node(f)->get_calls()) {
+            auto callee = call->get_operand(0)->as<Function>();
+            if (callee->get_name() == "neg_idx_except")
+                continue;
+            auto callee_node = call_graph_->get_node(callee);
+            if (not callee_node->is_external() and
+                callee_node->get_scc_id() == node->get_scc_id())
+                continue;
+            if (may_raise(callee)) {
+                result = true;
+                break;
             }
         }
-    is_pure[func] = true;
+    }
+    for (auto f : scc)
+        may_raise_[f] = result;
+    return result;
 }
 
-void FuncInfo::process(Function *func) {
-    for (auto &use : func->get_use_list()) {
-        LOG_INFO << use.val_->print() << " uses func: " << func->get_name();
-        if (auto inst = dynamic_cast<Instruction *>(use.val_)) {
-            auto func = (inst->get_parent()->get_parent());
-            if (is_pure[func]) {
-                is_pure[func] = false;
-                worklist.push_back(func);
-            }
-        } else
-            LOG_WARNING << "Value besides instruction uses a function";
+bool FuncInfo::has_live_check(Function *func) {
+    bool analyzed = false;
+    for (auto call : call_graph_->get_node(func)->get_calls()) {
+        if (call->get_operand(0)->get_name() != "neg_idx_except")
+            continue;
+        // 调用必须在某个负下标检查的 idx.neg 块中, 且下标一定非负
+        auto neg_bb = call->get_parent();
+        auto pre_bbs = neg_bb->get_pre_basic_blocks();
+        Value *idx;
+        BasicBlock *ok_bb, *matched_neg_bb;
+        if (pre_bbs.size() != 1 or
+            not match_neg_idx_check(pre_bbs.front(), idx, ok_bb,
+                                    matched_neg_bb) or
+            matched_neg_bb != neg_bb)
+            return true;
+        if (not analyzed) {
+            if (value_range_ == nullptr)
+                value_range_ = std::make_unique<ValueRange>(m_);
+            value_range_->run_on_func(func);
+            analyzed = true;
+        }
+        if (value_range_->get_range(idx, pre_bbs.front()).lo < 0)
+            return true;
     }
+    return false;
 }
 
-// 对局部变量进行 store 没有副作用
-bool FuncInfo::is_side_effect_inst(Instruction *inst) {
-    if (inst->is_store()) {
-        if (is_local_store(dynamic_cast<StoreInst *>(inst)))
-            return false;
-        return true;
+void FuncInfo::compute_local(Function *func) {
+    auto &summary = summaries_[func];
+    summary.read_args.assign(func->get_num_of_args(), false);
+    summary.written_args.assign(func->get_num_of_args(), false);
+    if (func->is_declaration()) {
+        // neg_idx_except 结束程序, 其他外部函数都是 I/O
+        if (func->get_name() == "neg_idx_except") {
+            summary.may_raise = true;
+            summary.may_not_return = true;
+        } else {
+            summary.calls_io = true;
+        }
+        for (auto &arg : func->get_args()) {
+            if (arg.get_type()->is_pointer_type()) {
+                summary.read_args[arg.get_arg_no()] = true;
+                summary.written_args[arg.get_arg_no()] = true;
+            }
+        }
+        return;
     }
-    if (inst->is_load()) {
-        if (is_local_load(dynamic_cast<LoadInst *>(inst)))
-            return false;
-        return true;
+    summary.may_not_return =
+        call_graph_->is_recursive(func) or has_cycle(func);
+    for (auto &bb : func->get_basic_blocks()) {
+        for (auto &inst : bb.get_instructions()) {
+            if (inst.is_load())
+                add_access(summary, static_cast<LoadInst *>(&inst)->get_lval(),
+                           false);
+            else if (inst.is_store())
+                add_access(summary, static_cast<StoreInst *>(&inst)->get_lval(),
+                           true);
+        }
     }
-    // call 指令的副作用会在后续 bfs 中计算
-    return false;
 }
 
-bool FuncInfo::is_local_load(LoadInst *inst) {
-    auto addr =
-        dynamic_cast<Instruction *>(get_first_addr(inst->get_operand(0)));
-    if (addr and addr->is_alloca())
-        return true;
-    return false;
+bool FuncInfo::merge_callees(Function *func) {
+    auto &summary = summaries_[func];
+    auto weight = get_weight(summary);
+    for (auto call : call_graph_->get_node(func)->get_calls()) {
+        auto callee = call->get_operand(0)->as<Function>();
+        // 复制一份, 自身递归时 summary 会在合并中改变
+        auto callee_summary = summaries_[callee];
+        summary.read_globals.insert(callee_summary.read_globals.begin(),
+                                    callee_summary.read_globals.end());
+        summary.written_globals.insert(callee_summary.written_globals.begin(),
+                                       callee_summary.written_globals.end());
+        summary.reads_unknown |= callee_summary.reads_unknown;
+        summary.writes_unknown |= callee_summary.writes_unknown;
+        summary.calls_io |= callee_summary.calls_io;
+        summary.may_raise |= callee_summary.may_raise;
+        summary.may_not_return |= callee_summary.may_not_return;
+        for (unsigned i = 0; i < callee_summary.read_args.size(); ++i) {
+            if (callee_summary.read_args[i])
+                add_access(summary, call->get_operand(i + 1), false);
+            if (callee_summary.written_args[i])
+                add_access(summary, call->get_operand(i + 1), true);
+        }
+    }
+    return get_weight(summary) != weight;
 }
 
-bool FuncInfo::is_local_store(StoreInst *inst) {
-    auto addr = dynamic_cast<Instruction *>(get_first_addr(inst->get_lval()));
-    if (addr and addr->is_alloca())
-        return true;
-    return false;
+void FuncInfo::add_access(Summary &summary, Value *ptr, bool is_write) {
+    auto addr = get_first_addr(ptr);
+    // 对局部变量的读写没有副作用
+    if (auto inst = dynamic_cast<Instruction *>(addr); inst and inst->is_alloca())
+        return;
+    if (auto global = dynamic_cast<GlobalVariable *>(addr)) {
+        (is_write ? summary.written_globals : summary.read_globals).insert(global);
+    } else if (auto arg = dynamic_cast<Argument *>(addr)) {
+        (is_write ? summary.written_args : summary.read_args)[arg->get_arg_no()] =
+            true;
+    } else {
+        (is_write ? summary.writes_unknown : summary.reads_unknown) = true;
+    }
 }
+
 Value *FuncInfo::get_first_addr(Value *val) {
     if (auto inst = dynamic_cast<Instruction *>(val)) {
         if (inst->is_alloca())
             return inst;
         if (inst->is_gep())
             return get_first_addr(inst->get_operand(0));
-        if (inst->is_load())
-            return val;
-        LOG_WARNING << "FuncInfo: try to determine addr in operands";
-        for (auto op : inst->get_operands()) {
-            if (op->get_type()->is_pointer_type())
-                return get_first_addr(op);
-        }
     }
+    // 全局变量、参数; 其他 (load 出的指针、指针的 phi) 无法确定基址
     return val;
 }
@@ -2,12 +2,15 @@
 #include "../../include/lightir/Function.hpp"
 
 #include "BasicBlock.hpp"
+#include "Constant.hpp"
 #include "Instruction.hpp"
 #include "Value.hpp"
 #include "Module.hpp"
 #include "logging.hpp"
 
+#include <algorithm>
 #include <cassert>
+#include <deque>
 #include <map>
 #include <set>
 #include <utility>
@@ -18,69 +21,84 @@ void FunctionInline::run() {
     inline_all_functions();
 }
 
-void FunctionInline::inline_all_functions() {
-    // 1. 收集递归函数
-    std::set<Function *> recursive_func;
-    for (auto &func : m_->get_functions()) {
-        for (auto &bb : func.get_basic_blocks()) {
-            for (auto &inst : bb.get_instructions()) {
-                if (!inst.is_call())
-                    continue;
-                auto *call   = static_cast<CallInst *>(&inst);
-                auto *callee = static_cast<Function *>(call->get_operand(0));
-                if (callee == &func) {
-                    recursive_func.insert(callee);
-                    break;
-                }
-            }
-        }
-    }
-
-    // 2. 对每个函数做内联
-    for (auto &func_ref : m_->get_functions()) {
-        auto *func = &func_ref;
-
-        // 跳过外部 I/O 函数本身
-        if (outside_func.count(func->get_name()))
-            continue;
-
-    a1:
-        for (auto &bb_ref : func->get_basic_blocks()) {
-            auto *bb = &bb_ref;
-            for (auto &inst_ref : bb->get_instructions()) {
-                auto *inst = &inst_ref;
-                if (!inst->is_call())
-                    continue;
+unsigned FunctionInline::get_size(Function *func) {
+    unsigned size = 0;
+    for (auto &bb : func->get_basic_blocks())
+        size += bb.get_num_of_instr();
+    return size;
+}
 
-                auto *call   = static_cast<CallInst *>(inst);
-                auto *callee = static_cast<Function *>(call->get_operand(0));
+void FunctionInline::inline_all_functions() {
+    loop_info_ = std::make_unique<LoopInfo>(m_);
+    call_graph_ = std::make_unique<CallGraph>(m_);
+    call_graph_->run();
+    module_size_ = 0;
+    for (auto &scc : call_graph_->get_sccs())
+        for (auto *func : scc)
+            module_size_ += get_size(func);
+    module_budget_ = std::max(module_size_ * 2, module_size_ + kMinGrowthBudget);
+
+    for (auto &scc : call_graph_->get_sccs())
+        for (auto *func : scc)
+            inline_into(func);
+    LOG_INFO << "function inline inlined " << inlined_count_ << " call sites";
+}
 
-                // 不内联递归调用到自身
-                if (callee == func)
-                    continue;
+int FunctionInline::get_inline_cost(const CallSite &site) {
+    auto *callee = static_cast<Function *>(site.call->get_operand(0));
+    // 内联后不再需要调用指令与传参
+    int cost = int(get_size(callee)) - int(site.call->get_num_operand());
+    for (unsigned i = 1; i < site.call->get_num_operand(); ++i)
+        if (dynamic_cast<Constant *>(site.call->get_operand(i)))
+            cost -= kConstArgBonus;
+    if (callee->get_use_list().size() == 1)
+        cost -= kSingleCallBonus;
+    return cost;
+}
 
-                // 不内联递归函数
-                if (recursive_func.count(callee))
-                    continue;
+void FunctionInline::inline_into(Function *caller) {
+    loop_info_->run_on_func(caller);
+    std::deque<CallSite> work_list;
+    for (auto &bb : caller->get_basic_blocks()) {
+        bool in_loop = loop_info_->get_loop_depth(&bb) > 0;
+        for (auto &inst : bb.get_instructions())
+            if (inst.is_call())
+                work_list.push_back({static_cast<CallInst *>(&inst), in_loop});
+    }
 
-                // 不内联外部 I/O 函数
-                if (outside_func.count(callee->get_name()))
-                    continue;
+    unsigned caller_size = get_size(caller);
+    unsigned caller_budget =
+        caller_size + std::max(caller_size, kMinGrowthBudget);
+    while (!work_list.empty()) {
+        auto site = work_list.front();
+        work_list.pop_front();
+        auto *callee = static_cast<Function *>(site.call->get_operand(0));
+
+        // 不内联外部 I/O 函数, 也不内联递归函数: 被调者在同一分量中时
+        // 内联会无限展开, 在更低的分量中时只会展开一层递归
+        if (callee->is_declaration() || outside_func.count(callee->get_name()))
+            continue;
+        if (call_graph_->is_recursive(callee))
+            continue;
 
-                // 过大的函数先不内联，避免代码膨胀
-                if (callee->get_basic_blocks().size() >= 6)
-                    continue;
+        int threshold = kInlineThreshold + (site.in_loop ? kLoopBonus : 0);
+        if (get_inline_cost(site) > threshold)
+            continue;
+        unsigned growth = get_size(callee);
+        if (caller_size + growth > caller_budget ||
+            module_size_ + growth > module_budget_)
+            continue;
 
-                // 真正进行一次内联，然后重新从头扫本函数
-                inline_function(call, callee);
-                goto a1;
-            }
-        }
+        for (auto *call : inline_function(site.call, callee))
+            work_list.push_back({call, site.in_loop});
+        caller_size += growth;
+        module_size_ += growth;
+        ++inlined_count_;
     }
 }
 
-void FunctionInline::inline_function(Instruction *call_inst, Function *origin) {
-    auto *call      = static_cast<CallInst *>(call_inst);
+std::vector<CallInst *> FunctionInline::inline_function(CallInst *call,
+                                                        Function *origin) {
     auto *call_bb   = call->get_parent();
     auto *call_func = call_bb->get_parent();
     auto *module    = call_func->get_parent();
@@ -97,7 +115,7 @@ void FunctionInline::inline_function(Instruction *call_inst, Function *origin) {
     unsigned total_ops = call->get_num_operand();
     if (total_ops < 1 + formal_cnt) {
         // 参数数量不匹配，保守起见直接不做内联，避免越界访问
-        return;
+        return {};
     }
 
     unsigned arg_idx = 1;
@@ -118,6 +136,7 @@ void FunctionInline::inline_function(Instruction *call_inst, Function *origin) {
     // 3. 克隆指令
     std::vector<Instruction *> ret_list;      // 非 void 返回指令列表
     std::vector<BasicBlock *>  ret_void_bbs;  // void 函数的返回基本块列表
+    std::vector<CallInst *>    new_calls;     // 复制进来的调用
 
     auto bb_it    = origin->get_basic_blocks().begin();
     auto newbb_it = new_bbs.begin();
@@ -146,6 +165,7 @@ void FunctionInline::inline_function(Instruction *call_inst, Function *origin) {
                     inner_call->get_operands().end()
                 );
                 inst_new = CallInst::create_call(callee, args, bb_new);
+                new_calls.push_back(static_cast<CallInst *>(inst_new));
             } else {
                 inst_new = inst->clone(bb_new);
             }
@@ -183,7 +203,7 @@ void FunctionInline::inline_function(Instruction *call_inst, Function *origin) {
             ret_val      = ret->get_operand(0);
             auto *ret_bb = ret->get_parent();
 
-            ret_bb->remove_instr(ret);
+            ret_bb->erase_instr(ret);
             BranchInst::create_br(bb_after_call, ret_bb);
         } else if (!ret_list.empty()) {
             // 多个 return：建 bb_phi + phi 汇总返回值
@@ -199,12 +219,13 @@ void FunctionInline::inline_function(Instruction *call_inst, Function *origin) {
                 phi_vals.push_back(ret_inst->get_operand(0));
                 phi_bbs.push_back(ret_bb);
 
-                ret_bb->remove_instr(ret_inst);
+                ret_bb->erase_instr(ret_inst);
                 BranchInst::create_br(bb_phi, ret_bb);
             }
 
             auto *phi = PhiInst::create_phi(origin->get_return_type(),
                                             bb_phi, phi_vals, phi_bbs);
+            bb_phi->add_instruction(phi);
             ret_val = phi;
 
             BranchInst::create_br(bb_after_call, bb_phi);
@@ -239,14 +260,36 @@ void FunctionInline::inline_function(Instruction *call_inst, Function *origin) {
         bb_after_call->add_instruction(inst);
         inst->set_parent(bb_after_call);
     }
+    // 后继中的 phi 现在从 bb_after_call 流入
+    for (auto *succ : bb_after_call->get_succ_basic_blocks()) {
+        for (auto &inst_ref : succ->get_instructions()) {
+            if (!inst_ref.is_phi())
+                break;
+            for (unsigned i = 1; i < inst_ref.get_num_operand(); i += 2)
+                if (inst_ref.get_operand(i) == call_bb)
+                    inst_ref.set_operand(i, bb_after_call);
+        }
+    }
 
     // 先处理call本身的返回值替换，再删掉call
     if (!origin->get_return_type()->is_void_type() && ret_val) {
         call->replace_all_use_with(ret_val);
     }
-    call_bb->remove_instr(call);
+    call_bb->erase_instr(call);
 
     // 到这里，call_bb已经不再有terminator，可以安全插入新的br
     auto *entry_bb = new_bbs.front();
     BranchInst::create_br(entry_bb, call_bb);
+
+    // 被调函数的 alloca 移到调用者的入口块, 避免在循环中反复分配栈空间
+    std::vector<Instruction *> allocas;
+    for (auto *bb_new : new_bbs)
+        for (auto &inst_ref : bb_new->get_instructions())
+            if (inst_ref.is_alloca())
+                allocas.push_back(&inst_ref);
+    for (auto *alloca : allocas) {
+        alloca->get_parent()->remove_instr(alloca);
+        call_func->get_entry_block()->add_instr_begin(alloca);
+    }
+    return new_calls;
 }
\ No newline at end of file
@@ -0,0 +1,205 @@
+#include "FunctionSpecialization.hpp"
+#include "Constant.hpp"
+#include "Function.hpp"
+#include "logging.hpp"
+
+#include <algorithm>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/DenseSet.h>
+
+void FunctionSpecialization::run() {
+    call_graph_ = std::make_unique<CallGraph>(m_);
+    call_graph_->run();
+    collect_candidates();
+
+    unsigned module_size = 0;
+    for (auto &f : m_->get_functions())
+        module_size += get_size(&f);
+    unsigned budget =
+        std::max(module_size * kMaxGrowthPercent / 100, kMinGrowthBudget);
+
+    // 收益相同时保持调用点出现的顺序, 使结果确定
+    std::stable_sort(candidates_.begin(), candidates_.end(),
+                     [](const Candidate &a, const Candidate &b) {
+                         return a.benefit > b.benefit;
+                     });
+    llvm::DenseMap<Function *, unsigned> clones;
+    unsigned growth = 0;
+    for (auto &candidate : candidates_) {
+        auto callee = candidate.callee;
+        unsigned size = get_size(callee);
+        if (clones[callee] >= kMaxClonesPerFunction or growth + size > budget)
+            continue;
+        auto name = callee->get_name() + "_spec" + std::to_string(clones[callee]);
+        auto clone = clone_function(callee, candidate.args, name);
+        for (auto call : candidate.calls)
+            call->set_operand(0, clone);
+        // 副本中实参相同的递归调用也改为调用副本
+        for (auto &bb : clone->get_basic_blocks())
+            for (auto &instr : bb.get_instructions())
+                if (instr.is_call() and instr.get_operand(0) == callee and
+                    get_const_args(static_cast<CallInst *>(&instr)) ==
+                        candidate.args)
+                    instr.set_operand(0, clone);
+        ++clones[callee];
+        growth += size;
+        ++clone_count_;
+        call_count_ += candidate.calls.size();
+    }
+    LOG_INFO << "function specialization created " << clone_count_
+             << " clones for " << call_count_ << " call sites";
+}
+
+unsigned FunctionSpecialization::get_size(Function *func) {
+    unsigned size = 0;
+    for (auto &bb : func->get_basic_blocks())
+        size += bb.get_num_of_instr();
+    return size;
+}
+
+bool FunctionSpecialization::can_specialize(Function *func) {
+    if (func->is_declaration() or func->get_name() == "main")
+        return false;
+    return call_graph_->get_node(func)->get_call_sites().size() ==
+           func->get_use_list().size();
+}
+
+FunctionSpecialization::ConstArgs
+FunctionSpecialization::get_const_args(CallInst *call) {
+    ConstArgs args;
+    for (unsigned i = 1; i < call->get_num_operand(); ++i) {
+        auto op = call->get_operand(i);
+        if (dynamic_cast<ConstantInt *>(op) or dynamic_cast<ConstantFP *>(op))
+            args.emplace_back(i - 1, static_cast<Constant *>(op));
+    }
+    return args;
+}
+
+void FunctionSpecialization::collect_candidates() {
+    candidates_.clear();
+    for (auto &f : m_->get_functions()) {
+        for (auto call : call_graph_->get_node(&f)->get_calls()) {
+            auto callee = call->get_operand(0)->as<Function>();
+            if (not can_specialize(callee))
+                continue;
+            auto args = get_const_args(call);
+            if (args.empty())
+                continue;
+            auto it = std::find_if(candidates_.begin(), candidates_.end(),
+                                   [&](const Candidate &c) {
+                                       return c.callee == callee and c.args == args;
+                                   });
+            if (it != candidates_.end()) {
+                it->calls.push_back(call);
+                continue;
+            }
+            int benefit = estimate_benefit(callee, args);
+            if (benefit < kMinBenefit or
+                benefit * 100 < int(get_size(callee)) * kMinBenefitPercent)
+                continue;
+            candidates_.push_back({callee, args, {call}, benefit});
+        }
+    }
+}
+
+int FunctionSpecialization::estimate_benefit(Function *func,
+                                             const ConstArgs &args) {
+    llvm::DenseMap<Value *, Constant *> known;
+    std::vector<Instruction *> work_list;
+    auto get_constant = [&](Value *val) -> Constant * {
+        if (dynamic_cast<ConstantInt *>(val) or dynamic_cast<ConstantFP *>(val))
+            return static_cast<Constant *>(val);
+        auto it = known.find(val);
+        return it != known.end() ? it->second : nullptr;
+    };
+    auto push_users = [&](Value *val) {
+        for (auto &use : val->get_use_list())
+            if (auto user = dynamic_cast<Instruction *>(use.val_))
+                work_list.push_back(user);
+    };
+    auto arg_it = func->get_args().begin();
+    for (auto [arg_no, c] : args) {
+        std::advance(arg_it, arg_no - arg_it->get_arg_no());
+        known[&*arg_it] = c;
+        push_users(&*arg_it);
+    }
+
+    int benefit = 0;
+    llvm::DenseSet<BasicBlock *> dead_bbs;
+    while (not work_list.empty()) {
+        auto instr = work_list.back();
+        work_list.pop_back();
+        if (known.count(instr))
+            continue;
+        if (instr->is_br()) {
+            auto br = static_cast<BranchInst *>(instr);
+            auto cond = br->is_cond_br()
+                            ? dynamic_cast<ConstantInt *>(
+                                  get_constant(br->get_condition()))
+                            : nullptr;
+            if (cond == nullptr)
+                continue;
+            // 只有这一个前驱的后继整块不再可达
+            auto dead = br->get_successor(cond->get_value() ? 1 : 0);
+            if (dead->get_pre_basic_blocks().size() == 1 and
+                dead_bbs.insert(dead).second)
+                benefit += dead->get_num_of_instr() + 1;
+            continue;
+        }
+        if (not instr->isBinary() and not instr->is_cmp() and
+            not instr->is_fcmp() and not instr->is_zext() and
+            not instr->is_si2fp() and not instr->is_fp2si())
+            continue;
+        Constant *operands[2] = {nullptr, nullptr};
+        bool all_constant = true;
+        for (unsigned i = 0; i < instr->get_num_operand(); ++i)
+            all_constant &= (operands[i] = get_constant(instr->get_operand(i))) != nullptr;
+        if (not all_constant)
+            continue;
+        auto folded = folder_.fold(instr, operands[0], operands[1]);
+        if (folded == nullptr)
+            continue;
+        known[instr] = folded;
+        ++benefit;
+        push_users(instr);
+    }
+    return benefit;
+}
+
+Function *FunctionSpecialization::clone_function(Function *func,
+                                                 const ConstArgs &args,
+                                                 const std::string &name) {
+    auto clone = Function::create(func->get_function_type(), name, m_);
+    llvm::DenseMap<Value *, Value *> map;
+    auto clone_arg = clone->get_args().begin();
+    for (auto &arg : func->get_args())
+        map[&arg] = &*clone_arg++;
+    // 常量实参直接代入
+    auto arg_it = func->get_args().begin();
+    for (auto [arg_no, c] : args) {
+        std::advance(arg_it, arg_no - arg_it->get_arg_no());
+        map[&*arg_it] = c;
+    }
+
+    for (auto &bb : func->get_basic_blocks())
+        map[&bb] = BasicBlock::create(m_, "", clone);
+    for (auto &bb : func->get_basic_blocks()) {
+        auto new_bb = static_cast<BasicBlock *>(map[&bb]);
+        for (auto &instr : bb.get_instructions()) {
+            if (instr.is_ret() and static_cast<ReturnInst *>(&instr)->is_void_ret())
+                ReturnInst::create_void_ret(new_bb);
+            else
+                map[&instr] = instr.clone(new_bb);
+        }
+    }
+    for (auto &bb : clone->get_basic_blocks()) {
+        for (auto &instr : bb.get_instructions()) {
+            for (unsigned i = 0; i < instr.get_num_operand(); ++i) {
+                auto it = map.find(instr.get_operand(i));
+                if (it != map.end())
+                    instr.set_operand(i, it->second);
+            }
+        }
+    }
+    return clone;
+}
@@ -0,0 +1,132 @@
+#include "GVN.hpp"
+#include "Function.hpp"
+#include "logging.hpp"
+
+#include <algorithm>
+#include <llvm/ADT/Hashing.h>
+
+size_t GVN::ExpressionHash::operator()(const Expression &expr) const {
+    return llvm::hash_combine(
+        expr.op, expr.type, expr.memory,
+        llvm::hash_combine_range(expr.operands.begin(), expr.operands.end()));
+}
+
+void GVN::run() {
+    func_info_->run();
+    dominators_ = std::make_unique<Dominators>(m_);
+    dominators_->run();
+    for (auto &f : m_->get_functions()) {
+        if (f.is_declaration())
+            continue;
+        run_on_func(&f);
+    }
+    LOG_INFO << "gvn pass eliminated " << ins_count_ << " instructions";
+}
+
+void GVN::run_on_func(Function *func) {
+    table_.clear();
+    scope_stack_.clear();
+    end_generation_.clear();
+
+    // 显式栈上的支配树先序遍历; 空指针标记一个块的子树结束,
+    // 其下记录的是进入该块前 scope_stack_ 的大小
+    std::vector<std::pair<BasicBlock *, size_t>> work_list;
+    work_list.push_back({func->get_entry_block(), 0});
+    while (not work_list.empty()) {
+        auto [bb, scope_size] = work_list.back();
+        work_list.pop_back();
+        if (bb == nullptr) {
+            while (scope_stack_.size() > scope_size) {
+                table_.erase(scope_stack_.back());
+                scope_stack_.pop_back();
+            }
+            continue;
+        }
+        work_list.push_back({nullptr, scope_stack_.size()});
+        process_block(bb);
+        for (auto succ : dominators_->get_dom_tree_succ_blocks(bb))
+            work_list.push_back({succ, 0});
+    }
+}
+
+void GVN::process_block(BasicBlock *bb) {
+    auto pre_bbs = bb->get_pre_basic_blocks();
+    if (pre_bbs.size() == 1 and end_generation_.count(pre_bbs.front()))
+        generation_ = end_generation_[pre_bbs.front()];
+    else
+        generation_ = ++next_generation_;
+
+    std::vector<Instruction *> wait_delete;
+    for (auto &instr : bb->get_instructions()) {
+        if (instr.is_store() or
+            (instr.is_call() and
+             func_info_
+                 ->get_summary(instr.get_operand(0)->as<Function>())
+                 .may_write()))
+            generation_ = ++next_generation_;
+        Expression expr;
+        if (not get_expression(&instr, expr))
+            continue;
+        auto [it, inserted] = table_.emplace(expr, &instr);
+        if (inserted) {
+            scope_stack_.push_back(std::move(expr));
+            continue;
+        }
+        instr.replace_all_use_with(it->second);
+        wait_delete.push_back(&instr);
+    }
+    end_generation_[bb] = generation_;
+    for (auto instr : wait_delete)
+        bb->erase_instr(instr);
+    ins_count_ += wait_delete.size();
+}
+
+bool GVN::get_expression(Instruction *instr, Expression &expr) {
+    if (instr->is_call()) {
+        auto func = instr->get_operand(0)->as<Function>();
+        if (instr->is_void() or not func_info_->is_read_only_function(func))
+            return false;
+        if (not func_info_->is_pure_function(func))
+            expr.memory = generation_;
+    } else if (not(instr->isBinary() or instr->is_cmp() or instr->is_fcmp() or
+                   instr->is_zext() or instr->is_si2fp() or
+                   instr->is_fp2si() or instr->is_gep())) {
+        return false;
+    }
+
+    expr.op = instr->get_instr_type();
+    expr.type = instr->get_type();
+    expr.operands.assign(instr->get_operands().begin(),
+                         instr->get_operands().end());
+
+    switch (expr.op) {
+    case Instruction::gt:
+    case Instruction::ge:
+    case Instruction::fgt:
+    case Instruction::fge: {
+        // a > b 与 b < a 是同一个表达式
+        static const std::unordered_map<Instruction::OpID, Instruction::OpID>
+            swapped = {{Instruction::gt, Instruction::lt},
+                       {Instruction::ge, Instruction::le},
+                       {Instruction::fgt, Instruction::flt},
+                       {Instruction::fge, Instruction::fle}};
+        expr.op = swapped.at(expr.op);
+        std::swap(expr.operands[0], expr.operands[1]);
+        break;
+    }
+    case Instruction::add:
+    case Instruction::mul:
+    case Instruction::fadd:
+    case Instruction::fmul:
+    case Instruction::eq:
+    case Instruction::ne:
+    case Instruction::feq:
+    case Instruction::fne:
+        if (std::less<Value *>()(expr.operands[1], expr.operands[0]))
+            std::swap(expr.operands[0], expr.operands[1]);
+        break;
+    default:
+        break;
+    }
+    return true;
+}
@@ -0,0 +1,184 @@
+#include "GlobalOpt.hpp"
+#include "Function.hpp"
+#include "logging.hpp"
+
+#include <algorithm>
+#include <llvm/ADT/SmallPtrSet.h>
+
+namespace {
+
+// 把地址 ptr 的使用分到 loads/stores 中, 有其他使用时返回 false
+bool collect_uses(Value *ptr, std::vector<LoadInst *> &loads,
+                  std::vector<StoreInst *> &stores) {
+    for (auto &use : ptr->get_use_list()) {
+        if (auto load = dynamic_cast<LoadInst *>(use.val_)) {
+            loads.push_back(load);
+        } else if (auto store = dynamic_cast<StoreInst *>(use.val_);
+                   store and use.arg_no_ == 1) {
+            stores.push_back(store);
+        } else if (auto gep = dynamic_cast<GetElementPtrInst *>(use.val_);
+                   gep and use.arg_no_ == 0) {
+            if (not collect_uses(gep, loads, stores))
+                return false;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+Function *get_main_function(Module *m) {
+    for (auto &f : m->get_functions())
+        if (f.get_name() == "main")
+            return &f;
+    return nullptr;
+}
+
+} // namespace
+
+void GlobalOpt::run() {
+    call_graph_ = std::make_unique<CallGraph>(m_);
+    call_graph_->run();
+    std::vector<GlobalVariable *> globals;
+    for (auto &global : m_->get_global_variable())
+        globals.push_back(&global);
+    for (auto global : globals) {
+        Accesses accesses;
+        if (not collect_accesses(global, accesses))
+            continue;
+        if (auto value = get_constant_value(global, accesses)) {
+            for (auto load : accesses.loads) {
+                load->replace_all_use_with(value);
+                load->get_parent()->erase_instr(load);
+            }
+            // 剩下的 store 不会再被读到
+            for (auto store : accesses.stores)
+                store->get_parent()->erase_instr(store);
+            // 只经过 gep 的访问要等 DeadCode 删掉 gep 后才没有使用
+            if (global->get_use_list().empty())
+                m_->get_global_variable().erase(global);
+            ++constant_count_;
+        } else if (can_localize(global, accesses)) {
+            localize(global, accesses.funcs.front());
+            ++localized_count_;
+        }
+    }
+    LOG_INFO << "global optimization turned " << constant_count_
+             << " globals into constants and localized " << localized_count_;
+}
+
+bool GlobalOpt::collect_accesses(GlobalVariable *global, Accesses &accesses) {
+    if (not collect_uses(global, accesses.loads, accesses.stores))
+        return false;
+    auto add_func = [&](Instruction *instr) {
+        auto func = instr->get_function();
+        if (std::find(accesses.funcs.begin(), accesses.funcs.end(), func) ==
+            accesses.funcs.end())
+            accesses.funcs.push_back(func);
+    };
+    for (auto load : accesses.loads)
+        add_func(load);
+    for (auto store : accesses.stores)
+        add_func(store);
+    return true;
+}
+
+Constant *GlobalOpt::get_init_value(GlobalVariable *global) {
+    auto type = global->get_type()->get_pointer_element_type();
+    auto init = global->get_init();
+    if (dynamic_cast<ConstantInt *>(init) or dynamic_cast<ConstantFP *>(init))
+        return init;
+    if (not dynamic_cast<ConstantZero *>(init))
+        return nullptr;
+    // 数组的每个元素也都是 0
+    if (type->is_array_type())
+        type = static_cast<ArrayType *>(type)->get_element_type();
+    if (type->is_float_type())
+        return ConstantFP::get(0.0, m_);
+    if (type->is_integer_type())
+        return ConstantInt::get(0, m_);
+    return nullptr;
+}
+
+Constant *GlobalOpt::get_constant_value(GlobalVariable *global,
+                                        const Accesses &accesses) {
+    auto init = get_init_value(global);
+    if (init == nullptr)
+        return nullptr;
+    if (accesses.stores.empty())
+        return init;
+    if (global->get_type()->get_pointer_element_type()->is_array_type())
+        return nullptr;
+    auto value = dynamic_cast<Constant *>(accesses.stores.front()->get_rval());
+    if (value == nullptr or
+        std::any_of(accesses.stores.begin(), accesses.stores.end(),
+                    [&](StoreInst *store) { return store->get_rval() != value; }))
+        return nullptr;
+    if (value == init)
+        return value;
+
+    // main 入口块在任何读与调用之前写入 value, 之后的读都只能读到它
+    auto main = get_main_function(m_);
+    if (main == nullptr or not main->get_use_list().empty())
+        return nullptr;
+    for (auto &instr : main->get_entry_block()->get_instructions()) {
+        if (instr.is_store() and static_cast<StoreInst *>(&instr)->get_lval() == global)
+            return value;
+        if (instr.is_call() or
+            (instr.is_load() and
+             std::find(accesses.loads.begin(), accesses.loads.end(), &instr) !=
+                 accesses.loads.end()))
+            return nullptr;
+    }
+    return nullptr;
+}
+
+bool GlobalOpt::can_localize(GlobalVariable *global, const Accesses &accesses) {
+    auto type = global->get_type()->get_pointer_element_type();
+    if (type->is_array_type() or accesses.funcs.size() != 1 or
+        get_init_value(global) == nullptr)
+        return false;
+    auto func = accesses.funcs.front();
+    // main 只执行一次
+    if (func == get_main_function(m_) and func->get_use_list().empty())
+        return true;
+    return not call_graph_->is_recursive(func) and is_stored_before_read(func, global);
+}
+
+bool GlobalOpt::is_stored_before_read(Function *func, GlobalVariable *global) {
+    llvm::SmallPtrSet<BasicBlock *, 16> visited;
+    std::vector<BasicBlock *> work_list{func->get_entry_block()};
+    visited.insert(func->get_entry_block());
+    while (not work_list.empty()) {
+        auto bb = work_list.back();
+        work_list.pop_back();
+        bool stored = false;
+        for (auto &instr : bb->get_instructions()) {
+            if (instr.is_load() and
+                static_cast<LoadInst *>(&instr)->get_lval() == global)
+                return false;
+            if (instr.is_store() and
+                static_cast<StoreInst *>(&instr)->get_lval() == global) {
+                stored = true;
+                break;
+            }
+        }
+        if (stored)
+            continue;
+        for (auto succ : bb->get_succ_basic_blocks())
+            if (visited.insert(succ).second)
+                work_list.push_back(succ);
+    }
+    return true;
+}
+
+void GlobalOpt::localize(GlobalVariable *global, Function *func) {
+    auto entry = func->get_entry_block();
+    auto alloca = AllocaInst::create_alloca(
+        global->get_type()->get_pointer_element_type(), nullptr);
+    entry->add_instr_begin(
+        StoreInst::create_store(get_init_value(global), alloca, nullptr));
+    entry->add_instr_begin(alloca);
+    global->replace_all_use_with(alloca);
+    m_->get_global_variable().erase(global);
+}
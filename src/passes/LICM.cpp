@@ -0,0 +1,368 @@
+#include "LICM.hpp"
+#include "Constant.hpp"
+#include "Function.hpp"
+#include "GlobalVariable.hpp"
+#include "logging.hpp"
+
+#include <algorithm>
+#include <llvm/ADT/SmallPtrSet.h>
+
+void LICM::run() {
+    alias_analysis_ = std::make_unique<AliasAnalysis>(m_);
+    alias_analysis_->run();
+    loop_info_ = std::make_unique<LoopInfo>(m_);
+    loop_info_->run();
+    for (auto &f : m_->get_functions()) {
+        if (f.is_declaration())
+            continue;
+        run_on_func(&f);
+    }
+    LOG_INFO << "licm pass hoisted " << hoisted_count_
+             << " instructions and promoted " << promoted_count_
+             << " memory locations";
+}
+
+void LICM::run_on_func(Function *func) {
+    // 内层循环先处理, 外提到内层 preheader 的指令还可以继续被外层外提
+    std::vector<Loop *> loops;
+    std::vector<Loop *> work_list(loop_info_->get_top_level_loops(func).begin(),
+                                  loop_info_->get_top_level_loops(func).end());
+    while (not work_list.empty()) {
+        auto loop = work_list.back();
+        work_list.pop_back();
+        loops.push_back(loop);
+        for (auto sub_loop : loop->get_sub_loops())
+            work_list.push_back(sub_loop);
+    }
+    if (loops.empty())
+        return;
+
+    // 先建好所有 preheader 再重新计算支配关系, 之后不再修改 CFG
+    for (auto loop : loops)
+        loop_info_->get_or_create_preheader(loop);
+    loop_info_->get_dominators()->run_on_func(func);
+
+    for (auto it = loops.rbegin(); it != loops.rend(); ++it) {
+        auto loop = *it;
+        auto preheader = loop->get_preheader();
+        if (preheader == nullptr)
+            continue;
+        collect_accesses(loop);
+        hoist(loop, preheader);
+        promote(loop, preheader);
+    }
+}
+
+void LICM::hoist(Loop *loop, BasicBlock *preheader) {
+    std::vector<BasicBlock *> blocks(loop->get_blocks().begin(),
+                                     loop->get_blocks().end());
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (auto bb : blocks) {
+            std::vector<Instruction *> instrs;
+            for (auto &instr : bb->get_instructions())
+                instrs.push_back(&instr);
+            for (auto instr : instrs) {
+                if (not can_hoist(loop, instr))
+                    continue;
+                bb->remove_instr(instr);
+                preheader->insert_before(preheader->get_terminator(), instr);
+                ++hoisted_count_;
+                changed = true;
+            }
+        }
+    }
+}
+
+bool LICM::is_invariant(Loop *loop, Value *val) const {
+    auto instr = dynamic_cast<Instruction *>(val);
+    return instr == nullptr or not loop->contains(instr->get_parent());
+}
+
+bool LICM::can_hoist(Loop *loop, Instruction *instr) {
+    if (instr->is_phi() or instr->is_br() or instr->is_ret() or
+        instr->is_store() or instr->is_alloca())
+        return false;
+    for (auto op : instr->get_operands())
+        if (not is_invariant(loop, op))
+            return false;
+
+    if (instr->is_load()) {
+        auto ptr = static_cast<LoadInst *>(instr)->get_lval();
+        if (may_be_written(ptr))
+            return false;
+        return is_dereferenceable(ptr) or is_guaranteed_to_execute(loop, instr);
+    }
+    if (instr->is_call()) {
+        auto call = static_cast<CallInst *>(instr);
+        auto callee = call->get_operand(0)->as<Function>();
+        auto func_info = alias_analysis_->get_func_info();
+        if (callee->is_declaration() or
+            not func_info->is_read_only_function(callee))
+            return false;
+        // 只读的调用还要求循环中没有写入它可能读到的内存
+        if (not func_info->is_pure_function(callee)) {
+            for (auto store : accesses_.stores)
+                if (alias_analysis_->call_may_read(call, store->get_lval()))
+                    return false;
+            for (auto other : accesses_.calls)
+                if (func_info->get_summary(other->get_operand(0)->as<Function>())
+                        .may_write())
+                    return false;
+        }
+        return is_guaranteed_to_execute(loop, instr);
+    }
+    return is_safe_to_speculate(instr) or is_guaranteed_to_execute(loop, instr);
+}
+
+bool LICM::is_safe_to_speculate(Instruction *instr) const {
+    if (instr->is_div()) {
+        // 除以 0 与 INT_MIN / -1 会陷入异常
+        auto divisor = dynamic_cast<ConstantInt *>(instr->get_operand(1));
+        return divisor and divisor->get_value() != 0 and
+               divisor->get_value() != -1;
+    }
+    return instr->isBinary() or instr->is_cmp() or instr->is_fcmp() or
+           instr->is_zext() or instr->is_si2fp() or instr->is_fp2si() or
+           instr->is_gep();
+}
+
+bool LICM::is_barrier(CallInst *call) const {
+    auto &summary = alias_analysis_->get_func_info()->get_summary(
+        call->get_operand(0)->as<Function>());
+    return summary.calls_io or summary.may_not_return;
+}
+
+bool LICM::is_guaranteed_to_execute(Loop *loop, Instruction *instr) {
+    // header 在每次进入循环时都会执行, 但 instr 之前的调用可能不返回或
+    // 结束程序. 其他块还要求循环中没有这样的调用: 例如 neg_idx_except
+    // 会在到达 instr 之前结束程序. instr 自己不算: 它不返回时, 外提与否
+    // 程序都停在它这里
+    auto bb = instr->get_parent();
+    if (bb == loop->get_header()) {
+        for (auto &prev : bb->get_instructions()) {
+            if (&prev == instr)
+                return true;
+            if (prev.is_call() and is_barrier(static_cast<CallInst *>(&prev)))
+                return false;
+        }
+    }
+    if (std::any_of(accesses_.calls.begin(), accesses_.calls.end(),
+                    [&](CallInst *call) {
+                        return call != instr and is_barrier(call);
+                    }))
+        return false;
+    auto exiting_blocks = loop->get_exiting_blocks();
+    if (exiting_blocks.empty())
+        return false;
+    auto dominators = loop_info_->get_dominators();
+    return std::all_of(
+        exiting_blocks.begin(), exiting_blocks.end(),
+        [&](BasicBlock *exiting) { return dominators->is_dominate(bb, exiting); });
+}
+
+bool LICM::has_dedicated_exits(Loop *loop) const {
+    for (auto exit : loop->get_exit_blocks())
+        for (auto pred : exit->get_pre_basic_blocks())
+            if (not loop->contains(pred))
+                return false;
+    return true;
+}
+
+void LICM::collect_accesses(Loop *loop) {
+    accesses_.loads.clear();
+    accesses_.stores.clear();
+    accesses_.calls.clear();
+    for (auto bb : loop->get_blocks()) {
+        for (auto &instr : bb->get_instructions()) {
+            if (instr.is_load())
+                accesses_.loads.push_back(static_cast<LoadInst *>(&instr));
+            else if (instr.is_store())
+                accesses_.stores.push_back(static_cast<StoreInst *>(&instr));
+            else if (instr.is_call())
+                accesses_.calls.push_back(static_cast<CallInst *>(&instr));
+        }
+    }
+}
+
+bool LICM::is_dereferenceable(Value *ptr) {
+    if (AliasAnalysis::is_identified_object(ptr))
+        return not ptr->get_type()->get_pointer_element_type()->is_array_type();
+    auto gep = dynamic_cast<GetElementPtrInst *>(ptr);
+    if (gep == nullptr or gep->get_num_operand() != 3 or
+        not AliasAnalysis::is_identified_object(gep->get_operand(0)))
+        return false;
+    auto array_type = gep->get_operand(0)->get_type()->get_pointer_element_type();
+    auto first = dynamic_cast<ConstantInt *>(gep->get_operand(1));
+    auto idx = dynamic_cast<ConstantInt *>(gep->get_operand(2));
+    return array_type->is_array_type() and first and first->get_value() == 0 and
+           idx and idx->get_value() >= 0 and
+           unsigned(idx->get_value()) <
+               static_cast<ArrayType *>(array_type)->get_num_of_elements();
+}
+
+bool LICM::may_be_written(Value *ptr) const {
+    for (auto store : accesses_.stores)
+        if (alias_analysis_->may_alias(store->get_lval(), ptr))
+            return true;
+    for (auto call : accesses_.calls)
+        if (alias_analysis_->call_may_modify(call, ptr))
+            return true;
+    return false;
+}
+
+void LICM::promote(Loop *loop, BasicBlock *preheader) {
+    if (not has_dedicated_exits(loop))
+        return;
+
+    std::vector<Value *> candidates;
+    for (auto store : accesses_.stores)
+        candidates.push_back(store->get_lval());
+    for (auto candidate : candidates) {
+        if (not is_invariant(loop, candidate) or
+            not is_dereferenceable(candidate))
+            continue;
+
+        llvm::SmallPtrSet<Instruction *, 8> promoted;
+        bool has_store = false;
+        bool conflict = false;
+        for (auto load : accesses_.loads) {
+            auto result = alias_analysis_->alias(load->get_lval(), candidate);
+            if (result == AliasResult::MustAlias)
+                promoted.insert(load);
+            else if (result == AliasResult::MayAlias)
+                conflict = true;
+        }
+        for (auto store : accesses_.stores) {
+            auto result = alias_analysis_->alias(store->get_lval(), candidate);
+            if (result == AliasResult::MustAlias) {
+                promoted.insert(store);
+                has_store = true;
+            } else if (result == AliasResult::MayAlias) {
+                conflict = true;
+            }
+        }
+        for (auto call : accesses_.calls)
+            conflict = conflict or
+                       alias_analysis_->call_may_access(call, candidate);
+        // 已经提升过的地址在循环中不再有 store
+        if (conflict or not has_store)
+            continue;
+
+        promoted_loop_ = loop;
+        block_entry_value_.clear();
+        block_last_store_.clear();
+        new_phis_.clear();
+        replaced_.clear();
+        initial_value_ = LoadInst::create_load(candidate, nullptr);
+        preheader->insert_before(preheader->get_terminator(),
+                                 static_cast<Instruction *>(initial_value_));
+
+        for (auto bb : loop->get_blocks())
+            for (auto &instr : bb->get_instructions())
+                if (instr.is_store() and promoted.count(&instr))
+                    block_last_store_[bb] = static_cast<StoreInst *>(&instr);
+
+        // 被替换的 load 可能还是其他 store 的值, 全部替换完成后再删除
+        std::vector<Instruction *> wait_delete;
+        for (auto bb : loop->get_blocks()) {
+            StoreInst *current = nullptr;
+            for (auto &instr : bb->get_instructions()) {
+                if (not promoted.count(&instr))
+                    continue;
+                wait_delete.push_back(&instr);
+                if (instr.is_store())
+                    current = static_cast<StoreInst *>(&instr);
+                else {
+                    auto val = current ? resolve(current->get_rval())
+                                       : read_at_entry(bb);
+                    instr.replace_all_use_with(val);
+                    replaced_[&instr] = val;
+                }
+            }
+        }
+
+        for (auto exit : loop->get_exit_blocks()) {
+            auto store = StoreInst::create_store(read_at_entry(exit), candidate,
+                                                 nullptr);
+            auto pos = exit->get_instructions().begin();
+            while (pos->is_phi())
+                ++pos;
+            exit->insert_before(pos, store);
+        }
+        for (auto instr : wait_delete)
+            instr->get_parent()->erase_instr(instr);
+        remove_trivial_phis();
+        ++promoted_count_;
+        collect_accesses(loop);
+    }
+}
+
+Value *LICM::read_at_entry(BasicBlock *bb) {
+    auto it = block_entry_value_.find(bb);
+    if (it != block_entry_value_.end())
+        return resolve(it->second);
+
+    auto preds = bb->get_pre_basic_blocks();
+    if (preds.size() == 1 and bb != promoted_loop_->get_header()) {
+        auto val = read_at_end(preds.front());
+        block_entry_value_[bb] = val;
+        return val;
+    }
+    // 先登记 phi 再求来源, 以便沿环路回到 bb 时终止
+    auto phi = PhiInst::create_phi(initial_value_->get_type(), bb);
+    bb->add_instr_begin(phi);
+    block_entry_value_[bb] = phi;
+    new_phis_.push_back(phi);
+    for (auto pred : preds) {
+        auto val = promoted_loop_->contains(pred) ? read_at_end(pred)
+                                                  : initial_value_;
+        phi->add_phi_pair_operand(val, pred);
+    }
+    return phi;
+}
+
+Value *LICM::read_at_end(BasicBlock *bb) {
+    auto it = block_last_store_.find(bb);
+    if (it != block_last_store_.end())
+        return resolve(it->second->get_rval());
+    return read_at_entry(bb);
+}
+
+Value *LICM::resolve(Value *val) const {
+    for (auto it = replaced_.find(val); it != replaced_.end();
+         it = replaced_.find(val))
+        val = it->second;
+    return val;
+}
+
+void LICM::remove_trivial_phis() {
+    // 所有来源 (除自身外) 都相同的 phi 可以用该来源替换
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (auto &phi : new_phis_) {
+            if (phi == nullptr)
+                continue;
+            Value *same = nullptr;
+            bool trivial = true;
+            for (unsigned i = 0; i < phi->get_num_operand(); i += 2) {
+                auto val = phi->get_operand(i);
+                if (val == phi or val == same)
+                    continue;
+                if (same != nullptr) {
+                    trivial = false;
+                    break;
+                }
+                same = val;
+            }
+            if (not trivial or same == nullptr)
+                continue;
+            phi->replace_all_use_with(same);
+            phi->get_parent()->erase_instr(phi);
+            phi = nullptr;
+            changed = true;
+        }
+    }
+}
@@ -0,0 +1,302 @@
+#include "LoopInfo.hpp"
+#include "Constant.hpp"
+#include "Function.hpp"
+#include "IRprinter.hpp"
+#include "logging.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+
+std::vector<BasicBlock *> Loop::get_exiting_blocks() const {
+    std::vector<BasicBlock *> exiting;
+    for (auto bb : blocks_) {
+        for (auto succ : bb->get_succ_basic_blocks()) {
+            if (not contains(succ)) {
+                exiting.push_back(bb);
+                break;
+            }
+        }
+    }
+    return exiting;
+}
+
+std::vector<BasicBlock *> Loop::get_exit_blocks() const {
+    std::vector<BasicBlock *> exits;
+    for (auto bb : blocks_)
+        for (auto succ : bb->get_succ_basic_blocks())
+            if (not contains(succ) and
+                std::find(exits.begin(), exits.end(), succ) == exits.end())
+                exits.push_back(succ);
+    return exits;
+}
+
+BasicBlock *Loop::get_preheader() const {
+    BasicBlock *outside = nullptr;
+    for (auto pred : header_->get_pre_basic_blocks()) {
+        if (contains(pred))
+            continue;
+        if (outside != nullptr and outside != pred)
+            return nullptr;
+        outside = pred;
+    }
+    if (outside == nullptr or outside->get_succ_basic_blocks().size() != 1)
+        return nullptr;
+    return outside;
+}
+
+bool Loop::get_bounds(Bounds &bounds) const {
+    bounds.preheader = get_preheader();
+    bounds.header = header_;
+    bounds.latch = get_latch();
+    if (bounds.preheader == nullptr or bounds.latch == nullptr or
+        bounds.latch == bounds.header)
+        return false;
+    auto exiting = get_exiting_blocks();
+    if (exiting.size() != 1 or exiting.front() != bounds.header)
+        return false;
+
+    auto br = dynamic_cast<BranchInst *>(bounds.header->get_terminator());
+    if (br == nullptr or not br->is_cond_br())
+        return false;
+    auto cmp = dynamic_cast<ICmpInst *>(br->get_condition());
+    if (cmp == nullptr)
+        return false;
+    bool true_in_loop = contains(br->get_successor(0));
+    bounds.body = br->get_successor(true_in_loop ? 0 : 1);
+    bounds.exit = br->get_successor(true_in_loop ? 1 : 0);
+    if (bounds.body == bounds.header)
+        return false;
+
+    // 整理为 iv pred limit 时继续循环
+    bounds.pred = cmp->get_instr_type();
+    bounds.iv = dynamic_cast<PhiInst *>(cmp->get_operand(0));
+    bounds.limit = cmp->get_operand(1);
+    if (bounds.iv == nullptr or bounds.iv->get_parent() != bounds.header) {
+        bounds.iv = dynamic_cast<PhiInst *>(cmp->get_operand(1));
+        bounds.limit = cmp->get_operand(0);
+        bounds.pred = ICmpInst::get_swapped_predicate(bounds.pred);
+    }
+    if (bounds.iv == nullptr or bounds.iv->get_parent() != bounds.header)
+        return false;
+    if (not true_in_loop)
+        bounds.pred = ICmpInst::get_inverse_predicate(bounds.pred);
+    auto limit = dynamic_cast<Instruction *>(bounds.limit);
+    if (limit and contains(limit->get_parent()))
+        return false;
+
+    // iv = phi [init, preheader], [iv + step, latch]
+    if (bounds.iv->get_num_operand() != 4)
+        return false;
+    Value *next = nullptr;
+    bounds.init = nullptr;
+    for (auto [val, bb] : bounds.iv->get_phi_pairs()) {
+        if (bb == bounds.preheader)
+            bounds.init = val;
+        else if (bb == bounds.latch)
+            next = val;
+    }
+    auto inc = dynamic_cast<IBinaryInst *>(next);
+    if (bounds.init == nullptr or inc == nullptr or
+        not(inc->is_add() or inc->is_sub()))
+        return false;
+    auto lhs = inc->get_operand(0);
+    auto rhs = inc->get_operand(1);
+    if (inc->is_add() and rhs == bounds.iv)
+        std::swap(lhs, rhs);
+    auto step = dynamic_cast<ConstantInt *>(rhs);
+    if (lhs != bounds.iv or step == nullptr or step->get_value() == 0 or
+        step->get_value() == INT_MIN)
+        return false;
+    bounds.step = inc->is_sub() ? -step->get_value() : step->get_value();
+    return true;
+}
+
+void LoopInfo::run() {
+    loops_.clear();
+    top_level_loops_.clear();
+    bb_map_.clear();
+    dominators_ = std::make_unique<Dominators>(m_);
+    for (auto &f : m_->get_functions()) {
+        if (f.is_declaration())
+            continue;
+        run_on_func(&f);
+    }
+    LOG_INFO << "loop info found " << loops_.size() << " loops";
+}
+
+void LoopInfo::run_on_func(Function *func) {
+    if (dominators_ == nullptr)
+        dominators_ = std::make_unique<Dominators>(m_);
+    dominators_->run_on_func(func);
+    // 允许对修改过 CFG 的函数重新分析
+    top_level_loops_[func].clear();
+    for (auto &bb : func->get_basic_blocks())
+        bb_map_.erase(&bb);
+
+    // 支配树后序: 内层循环的 header 先于外层循环处理
+    for (auto header : dominators_->get_dom_post_order()) {
+        llvm::SmallVector<BasicBlock *, 2> latches;
+        for (auto pred : header->get_pre_basic_blocks()) {
+            if (dominators_->is_reachable(pred) and
+                dominators_->is_dominate(header, pred) and
+                std::find(latches.begin(), latches.end(), pred) ==
+                    latches.end())
+                latches.push_back(pred);
+        }
+        if (latches.empty())
+            continue;
+        loops_.emplace_back(new Loop(header));
+        discover_loop(loops_.back().get(), latches);
+    }
+    populate_loops(func);
+}
+
+void LoopInfo::discover_loop(Loop *loop, llvm::ArrayRef<BasicBlock *> latches) {
+    loop->latches_.assign(latches.begin(), latches.end());
+    bb_map_[loop->header_] = loop;
+
+    std::vector<BasicBlock *> work_list(latches.begin(), latches.end());
+    while (not work_list.empty()) {
+        auto bb = work_list.back();
+        work_list.pop_back();
+        auto sub_loop = bb_map_.lookup(bb);
+        if (sub_loop == nullptr) {
+            if (not dominators_->is_reachable(bb))
+                continue;
+            bb_map_[bb] = loop;
+            for (auto pred : bb->get_pre_basic_blocks())
+                work_list.push_back(pred);
+            continue;
+        }
+        // bb 属于已经发现的内层循环: 把它最外层的祖先挂到 loop 下,
+        // 从该祖先 header 的循环外前驱继续搜索
+        while (sub_loop->parent_ != nullptr)
+            sub_loop = sub_loop->parent_;
+        if (sub_loop == loop)
+            continue;
+        sub_loop->parent_ = loop;
+        for (auto pred : sub_loop->header_->get_pre_basic_blocks())
+            if (bb_map_.lookup(pred) != sub_loop)
+                work_list.push_back(pred);
+    }
+}
+
+void LoopInfo::populate_loops(Function *func) {
+    // header 支配循环中的所有块, 所以先序遍历时 header 最先出现,
+    // 外层循环也先于内层循环出现
+    for (auto bb : dominators_->get_dom_dfs_order()) {
+        auto innermost = bb_map_.lookup(bb);
+        if (innermost == nullptr)
+            continue;
+        if (innermost->header_ == bb) {
+            if (auto parent = innermost->parent_) {
+                parent->sub_loops_.push_back(innermost);
+                innermost->depth_ = parent->depth_ + 1;
+            } else {
+                top_level_loops_[func].push_back(innermost);
+                innermost->depth_ = 1;
+            }
+        }
+        for (auto loop = innermost; loop != nullptr; loop = loop->parent_)
+            loop->add_block(bb);
+    }
+}
+
+llvm::ArrayRef<Loop *> LoopInfo::get_top_level_loops(Function *func) const {
+    auto it = top_level_loops_.find(func);
+    if (it == top_level_loops_.end())
+        return {};
+    return it->second;
+}
+
+BasicBlock *LoopInfo::get_or_create_preheader(Loop *loop) {
+    if (auto preheader = loop->get_preheader())
+        return preheader;
+
+    auto header = loop->get_header();
+    llvm::SmallVector<BasicBlock *, 4> outside_preds;
+    for (auto pred : header->get_pre_basic_blocks())
+        if (not loop->contains(pred) and
+            std::find(outside_preds.begin(), outside_preds.end(), pred) ==
+                outside_preds.end())
+            outside_preds.push_back(pred);
+    if (outside_preds.empty())
+        return nullptr;
+
+    auto preheader = BasicBlock::create(m_, "", header->get_parent());
+    auto is_outside = [&](Value *bb) {
+        return std::find(outside_preds.begin(), outside_preds.end(), bb) !=
+               outside_preds.end();
+    };
+
+    // header 中来自循环外的 phi 来源移到 preheader
+    for (auto &instr : header->get_instructions()) {
+        if (not instr.is_phi())
+            break;
+        auto phi = static_cast<PhiInst *>(&instr);
+        if (outside_preds.size() == 1) {
+            for (unsigned i = 1; i < phi->get_num_operand(); i += 2)
+                if (is_outside(phi->get_operand(i)))
+                    phi->set_operand(i, preheader);
+            continue;
+        }
+        std::vector<Value *> vals;
+        std::vector<BasicBlock *> val_bbs;
+        for (auto [val, bb] : phi->get_phi_pairs()) {
+            if (is_outside(bb)) {
+                vals.push_back(val);
+                val_bbs.push_back(bb);
+            }
+        }
+        for (auto bb : val_bbs)
+            phi->remove_phi_operand(bb);
+        Value *incoming = vals.front();
+        if (std::any_of(vals.begin(), vals.end(),
+                        [&](Value *val) { return val != incoming; })) {
+            auto new_phi =
+                PhiInst::create_phi(phi->get_type(), preheader, vals, val_bbs);
+            preheader->add_instruction(new_phi);
+            incoming = new_phi;
+        }
+        phi->add_phi_pair_operand(incoming, preheader);
+    }
+
+    // 改写跳转目标时 BranchInst 会同步维护 CFG 的边
+    for (auto pred : outside_preds) {
+        auto term = pred->get_terminator();
+        for (unsigned i = 0; i < term->get_num_operand(); ++i)
+            if (term->get_operand(i) == header)
+                term->set_operand(i, preheader);
+    }
+    BranchInst::create_br(header, preheader);
+
+    if (auto parent = loop->get_parent()) {
+        bb_map_[preheader] = parent;
+        for (auto outer = parent; outer != nullptr; outer = outer->parent_)
+            outer->add_block(preheader);
+    }
+    return preheader;
+}
+
+void LoopInfo::print(Function *func) {
+    SlotTracker slots(func);
+    printf("Loops of function %s:\n", func->get_name().c_str());
+    std::vector<Loop *> work_list;
+    auto top_level = get_top_level_loops(func);
+    work_list.assign(top_level.rbegin(), top_level.rend());
+    while (not work_list.empty()) {
+        auto loop = work_list.back();
+        work_list.pop_back();
+        std::string output(2 * loop->get_depth(), ' ');
+        output += "depth " + std::to_string(loop->get_depth()) + ": ";
+        for (auto bb : loop->get_blocks())
+            output += slots.get_local_name(bb) + " ";
+        output += "| latches:";
+        for (auto bb : loop->get_latches())
+            output += " " + slots.get_local_name(bb);
+        printf("%s\n", output.c_str());
+        auto sub_loops = loop->get_sub_loops();
+        work_list.insert(work_list.end(), sub_loops.rbegin(), sub_loops.rend());
+    }
+}
@@ -0,0 +1,241 @@
+#include "LoopStrengthReduce.hpp"
+#include "Constant.hpp"
+#include "Function.hpp"
+#include "logging.hpp"
+
+#include <vector>
+
+void LoopStrengthReduce::run() {
+    loop_info_ = std::make_unique<LoopInfo>(m_);
+    loop_info_->run();
+    for (auto &f : m_->get_functions()) {
+        if (f.is_declaration())
+            continue;
+        run_on_func(&f);
+    }
+    LOG_INFO << "loop strength reduction replaced " << reduced_count_
+             << " expressions";
+}
+
+void LoopStrengthReduce::run_on_func(Function *func) {
+    std::vector<Loop *> loops;
+    std::vector<Loop *> work_list(loop_info_->get_top_level_loops(func).begin(),
+                                  loop_info_->get_top_level_loops(func).end());
+    while (not work_list.empty()) {
+        auto loop = work_list.back();
+        work_list.pop_back();
+        loops.push_back(loop);
+        for (auto sub_loop : loop->get_sub_loops())
+            work_list.push_back(sub_loop);
+    }
+    for (auto loop : loops)
+        loop_info_->get_or_create_preheader(loop);
+    // 内层循环先处理
+    for (auto it = loops.rbegin(); it != loops.rend(); ++it)
+        run_on_loop(*it);
+}
+
+void LoopStrengthReduce::run_on_loop(Loop *loop) {
+    loop_ = loop;
+    preheader_ = loop->get_preheader();
+    auto latch = loop->get_latch();
+    if (preheader_ == nullptr or latch == nullptr)
+        return;
+    induction_vars_.clear();
+    affine_cache_.clear();
+    new_ivs_.clear();
+    find_induction_variables(loop);
+    if (induction_vars_.empty())
+        return;
+
+    // 含有对归纳变量乘法的派生归纳变量
+    std::vector<Instruction *> candidates;
+    for (auto bb : loop->get_blocks()) {
+        for (auto &instr : bb->get_instructions()) {
+            if (not instr.is_add() and not instr.is_sub() and not instr.is_mul())
+                continue;
+            Affine affine;
+            if (get_affine(&instr, affine) and affine.iv and affine.has_mul)
+                candidates.push_back(&instr);
+        }
+    }
+
+    auto in_loop = [&](Use *use) {
+        auto user = dynamic_cast<Instruction *>(use->val_);
+        return user and loop_->contains(user->get_parent());
+    };
+    for (auto instr : candidates) {
+        // 只替换表达式树的根: 循环内有不是派生归纳变量的使用者
+        bool is_root = false;
+        for (auto &use : instr->get_use_list()) {
+            auto user = dynamic_cast<Instruction *>(use.val_);
+            Affine user_affine;
+            if (user and loop->contains(user->get_parent()) and
+                not(get_affine(user, user_affine) and user_affine.iv and
+                    user_affine.has_mul)) {
+                is_root = true;
+                break;
+            }
+        }
+        if (not is_root)
+            continue;
+
+        auto affine = affine_cache_.lookup(instr);
+        auto &phi = new_ivs_[{affine.iv, affine.scale, affine.offset}];
+        if (phi == nullptr) {
+            auto &basic = induction_vars_[affine.iv];
+            auto init = make_add(make_mul(affine.scale, basic.init),
+                                 affine.offset);
+            auto step = make_mul(affine.scale, basic.step);
+            auto header = loop->get_header();
+            phi = PhiInst::create_phi(affine.iv->get_type(), header);
+            header->add_instr_begin(phi);
+            auto next = IBinaryInst::create_add(phi, step, nullptr);
+            latch->insert_before(latch->get_terminator(), next);
+            phi->add_phi_pair_operand(init, preheader_);
+            phi->add_phi_pair_operand(next, latch);
+        }
+        // 循环外的使用者需要的是最后一次迭代的值, 保持不变
+        instr->replace_use_with_if(phi, in_loop);
+        ++reduced_count_;
+    }
+}
+
+void LoopStrengthReduce::find_induction_variables(Loop *loop) {
+    auto latch = loop->get_latch();
+    for (auto &instr : loop->get_header()->get_instructions()) {
+        if (not instr.is_phi())
+            break;
+        auto phi = static_cast<PhiInst *>(&instr);
+        if (not phi->get_type()->is_int32_type() or
+            phi->get_num_operand() != 4)
+            continue;
+        Value *init = nullptr;
+        Value *next = nullptr;
+        for (auto [val, bb] : phi->get_phi_pairs()) {
+            if (bb == preheader_)
+                init = val;
+            else if (bb == latch)
+                next = val;
+        }
+        auto inc = dynamic_cast<IBinaryInst *>(next);
+        if (init == nullptr or inc == nullptr or
+            not(inc->is_add() or inc->is_sub()))
+            continue;
+        // i + c, c + i 或 i - c
+        auto lhs = inc->get_operand(0);
+        auto rhs = inc->get_operand(1);
+        if (inc->is_add() and rhs == phi)
+            std::swap(lhs, rhs);
+        auto step = dynamic_cast<ConstantInt *>(rhs);
+        if (lhs != phi or step == nullptr)
+            continue;
+        if (inc->is_sub())
+            step = ConstantInt::get(int(0u - unsigned(step->get_value())), m_);
+        induction_vars_[phi] = {init, step};
+    }
+}
+
+bool LoopStrengthReduce::get_affine(Value *val, Affine &affine) {
+    auto it = affine_cache_.find(val);
+    if (it != affine_cache_.end()) {
+        affine = it->second;
+        return affine.offset != nullptr;
+    }
+    auto zero = ConstantInt::get(0, m_);
+    auto instr = dynamic_cast<Instruction *>(val);
+    bool ok = true;
+    if (instr == nullptr or not loop_->contains(instr->get_parent())) {
+        affine = {nullptr, zero, val, false};
+    } else if (auto phi = dynamic_cast<PhiInst *>(instr);
+               phi and induction_vars_.count(phi)) {
+        affine = {phi, ConstantInt::get(1, m_), zero, false};
+    } else {
+        ok = compute_affine(instr, affine);
+    }
+    if (not ok)
+        affine = {};
+    affine_cache_[val] = affine;
+    return ok;
+}
+
+bool LoopStrengthReduce::compute_affine(Instruction *instr, Affine &affine) {
+    if (not instr->is_add() and not instr->is_sub() and not instr->is_mul())
+        return false;
+    Affine lhs, rhs;
+    if (not get_affine(instr->get_operand(0), lhs) or
+        not get_affine(instr->get_operand(1), rhs))
+        return false;
+    if (lhs.iv and rhs.iv and lhs.iv != rhs.iv)
+        return false;
+
+    affine.iv = lhs.iv ? lhs.iv : rhs.iv;
+    affine.has_mul = lhs.has_mul or rhs.has_mul;
+    if (instr->is_add()) {
+        affine.scale = make_add(lhs.scale, rhs.scale);
+        affine.offset = make_add(lhs.offset, rhs.offset);
+        return true;
+    }
+    if (instr->is_sub()) {
+        affine.scale = make_sub(lhs.scale, rhs.scale);
+        affine.offset = make_sub(lhs.offset, rhs.offset);
+        return true;
+    }
+    // 乘法要求一侧是循环不变量
+    if (lhs.iv and rhs.iv)
+        return false;
+    if (rhs.iv)
+        std::swap(lhs, rhs);
+    affine.scale = make_mul(lhs.scale, rhs.offset);
+    affine.offset = make_mul(lhs.offset, rhs.offset);
+    affine.has_mul = affine.has_mul or affine.iv != nullptr;
+    return true;
+}
+
+// 常量按 i32 回绕折叠
+Value *LoopStrengthReduce::make_add(Value *lhs, Value *rhs) {
+    auto c1 = dynamic_cast<ConstantInt *>(lhs);
+    auto c2 = dynamic_cast<ConstantInt *>(rhs);
+    if (c1 and c2)
+        return ConstantInt::get(
+            int(unsigned(c1->get_value()) + unsigned(c2->get_value())), m_);
+    if (c1 and c1->get_value() == 0)
+        return rhs;
+    if (c2 and c2->get_value() == 0)
+        return lhs;
+    auto instr = IBinaryInst::create_add(lhs, rhs, nullptr);
+    preheader_->insert_before(preheader_->get_terminator(), instr);
+    return instr;
+}
+
+Value *LoopStrengthReduce::make_sub(Value *lhs, Value *rhs) {
+    auto c1 = dynamic_cast<ConstantInt *>(lhs);
+    auto c2 = dynamic_cast<ConstantInt *>(rhs);
+    if (c1 and c2)
+        return ConstantInt::get(
+            int(unsigned(c1->get_value()) - unsigned(c2->get_value())), m_);
+    if (c2 and c2->get_value() == 0)
+        return lhs;
+    auto instr = IBinaryInst::create_sub(lhs, rhs, nullptr);
+    preheader_->insert_before(preheader_->get_terminator(), instr);
+    return instr;
+}
+
+Value *LoopStrengthReduce::make_mul(Value *lhs, Value *rhs) {
+    auto c1 = dynamic_cast<ConstantInt *>(lhs);
+    auto c2 = dynamic_cast<ConstantInt *>(rhs);
+    if (c1 and c2)
+        return ConstantInt::get(
+            int(unsigned(c1->get_value()) * unsigned(c2->get_value())), m_);
+    if (c1 and c1->get_value() == 0)
+        return lhs;
+    if (c2 and c2->get_value() == 0)
+        return rhs;
+    if (c1 and c1->get_value() == 1)
+        return rhs;
+    if (c2 and c2->get_value() == 1)
+        return lhs;
+    auto instr = IBinaryInst::create_mul(lhs, rhs, nullptr);
+    preheader_->insert_before(preheader_->get_terminator(), instr);
+    return instr;
+}
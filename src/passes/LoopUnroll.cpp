@@ -0,0 +1,292 @@
+#include "LoopUnroll.hpp"
+#include "Constant.hpp"
+#include "Function.hpp"
+#include "logging.hpp"
+
+#include <climits>
+
+namespace {
+
+bool evaluate(Instruction::OpID pred, long lhs, long rhs) {
+    switch (pred) {
+    case Instruction::lt:
+        return lhs < rhs;
+    case Instruction::le:
+        return lhs <= rhs;
+    case Instruction::gt:
+        return lhs > rhs;
+    case Instruction::ge:
+        return lhs >= rhs;
+    case Instruction::eq:
+        return lhs == rhs;
+    default:
+        return lhs != rhs;
+    }
+}
+
+} // namespace
+
+void LoopUnroll::run() {
+    loop_info_ = std::make_unique<LoopInfo>(m_);
+    loop_info_->run();
+    for (auto &f : m_->get_functions()) {
+        if (f.is_declaration())
+            continue;
+        // 只展开最内层循环, 它们互不重叠, 展开一个不影响其他循环的分析结果
+        std::vector<Loop *> innermost;
+        std::vector<Loop *> work_list(
+            loop_info_->get_top_level_loops(&f).begin(),
+            loop_info_->get_top_level_loops(&f).end());
+        while (not work_list.empty()) {
+            auto loop = work_list.back();
+            work_list.pop_back();
+            if (loop->is_innermost())
+                innermost.push_back(loop);
+            for (auto sub_loop : loop->get_sub_loops())
+                work_list.push_back(sub_loop);
+        }
+        for (auto loop : innermost) {
+            if (loop_info_->get_or_create_preheader(loop) == nullptr)
+                continue;
+            LoopShape shape;
+            if (not loop->get_bounds(shape))
+                continue;
+            auto size = get_loop_size(loop);
+            auto trip_count =
+                get_trip_count(shape, std::min<long>(kMaxFullUnrollTrip,
+                                                     kUnrollBudget / size));
+            if (trip_count >= 0)
+                fully_unroll(loop, shape, trip_count);
+            else if (factor_ >= 2 and size * factor_ <= kUnrollBudget)
+                partially_unroll(loop, shape);
+        }
+    }
+    LOG_INFO << "loop unroll fully unrolled " << full_count_
+             << " loops and partially unrolled " << partial_count_
+             << " loops";
+}
+
+long LoopUnroll::get_trip_count(const LoopShape &shape, long max_trip) const {
+    auto init = dynamic_cast<ConstantInt *>(shape.init);
+    auto limit = dynamic_cast<ConstantInt *>(shape.limit);
+    if (init == nullptr or limit == nullptr)
+        return -1;
+    // 在 64 位上模拟, iv 超出 i32 (即发生回绕) 时放弃
+    long iv = init->get_value();
+    long trip = 0;
+    while (evaluate(shape.pred, iv, limit->get_value())) {
+        if (++trip > max_trip)
+            return -1;
+        iv += shape.step;
+        if (iv < INT_MIN or iv > INT_MAX)
+            return -1;
+    }
+    return trip;
+}
+
+unsigned LoopUnroll::get_loop_size(Loop *loop) const {
+    unsigned size = 0;
+    for (auto bb : loop->get_blocks())
+        size += bb->get_num_of_instr();
+    return size;
+}
+
+LoopUnroll::ClonedIterations
+LoopUnroll::clone_iterations(Loop *loop, const LoopShape &shape,
+                             unsigned count, ValueMap initial,
+                             BasicBlock *after) {
+    auto func = shape.header->get_parent();
+    auto blocks = loop->get_blocks();
+
+    // 先为每份副本建好基本块, 以便 latch 跳到下一份的 header
+    std::vector<ValueMap> maps(count);
+    for (auto &map : maps)
+        for (auto bb : blocks)
+            map[bb] = BasicBlock::create(m_, "", func);
+
+    ValueMap current = std::move(initial);
+    for (unsigned j = 0; j < count; ++j) {
+        auto &map = maps[j];
+        for (auto [phi, val] : current)
+            map[phi] = val;
+        auto next_header =
+            j + 1 < count ? maps[j + 1][shape.header] : after;
+
+        std::vector<BasicBlock *> new_bbs;
+        for (auto bb : blocks) {
+            auto new_bb = static_cast<BasicBlock *>(map[bb]);
+            new_bbs.push_back(new_bb);
+            for (auto &instr : bb->get_instructions()) {
+                if (bb == shape.header and instr.is_phi())
+                    continue;
+                if (bb == shape.header and instr.is_br()) {
+                    BranchInst::create_br(
+                        static_cast<BasicBlock *>(map[shape.body]), new_bb);
+                    continue;
+                }
+                map[&instr] = instr.clone(new_bb);
+            }
+        }
+        for (auto new_bb : new_bbs) {
+            for (auto &instr : new_bb->get_instructions()) {
+                for (unsigned i = 0; i < instr.get_num_operand(); ++i) {
+                    auto op = instr.get_operand(i);
+                    // 只有 latch 跳回 header, 改为进入下一次迭代
+                    if (op == shape.header and instr.is_br()) {
+                        instr.set_operand(i, next_header);
+                        continue;
+                    }
+                    auto it = map.find(op);
+                    if (it != map.end())
+                        instr.set_operand(i, it->second);
+                }
+            }
+        }
+
+        // 下一次迭代时 header 中 phi 的值是本次 latch 传入的值
+        ValueMap next;
+        for (auto [phi, val] : current) {
+            auto latch_val = static_cast<PhiInst *>(phi)->get_operand(0);
+            for (auto [incoming, bb] : static_cast<PhiInst *>(phi)->get_phi_pairs())
+                if (bb == shape.latch)
+                    latch_val = incoming;
+            auto it = map.find(latch_val);
+            next[phi] = it != map.end() ? it->second : latch_val;
+        }
+        current = std::move(next);
+    }
+    return {static_cast<BasicBlock *>(maps.front()[shape.header]),
+            static_cast<BasicBlock *>(maps.back()[shape.latch]),
+            std::move(current)};
+}
+
+void LoopUnroll::fully_unroll(Loop *loop, const LoopShape &shape,
+                              unsigned trip_count) {
+    auto header = shape.header;
+    ValueMap initial;
+    for (auto &instr : header->get_instructions()) {
+        if (not instr.is_phi())
+            break;
+        for (auto [val, bb] : static_cast<PhiInst *>(&instr)->get_phi_pairs())
+            if (bb == shape.preheader)
+                initial[&instr] = val;
+    }
+
+    if (trip_count > 0) {
+        auto cloned = clone_iterations(loop, shape, trip_count, initial, header);
+        auto term = shape.preheader->get_terminator();
+        for (unsigned i = 0; i < term->get_num_operand(); ++i)
+            if (term->get_operand(i) == header)
+                term->set_operand(i, cloned.entry);
+        // 原 header 只剩最后一次 (不成立的) 判断
+        for (auto &instr : header->get_instructions()) {
+            if (not instr.is_phi())
+                break;
+            auto phi = static_cast<PhiInst *>(&instr);
+            phi->remove_phi_operand(shape.preheader);
+            phi->remove_phi_operand(shape.latch);
+            phi->add_phi_pair_operand(cloned.final_values.lookup(phi),
+                                      cloned.last_latch);
+        }
+    } else {
+        for (auto &instr : header->get_instructions()) {
+            if (not instr.is_phi())
+                break;
+            static_cast<PhiInst *>(&instr)->remove_phi_operand(shape.latch);
+        }
+    }
+    header->erase_instr(header->get_terminator());
+    BranchInst::create_br(shape.exit, header);
+
+    // 原循环体已经不可达
+    std::vector<BasicBlock *> dead_bbs;
+    for (auto bb : loop->get_blocks())
+        if (bb != header)
+            dead_bbs.push_back(bb);
+    for (auto bb : dead_bbs) {
+        bb->erase_from_parent();
+        delete bb;
+    }
+    ++full_count_;
+}
+
+bool LoopUnroll::partially_unroll(Loop *loop, const LoopShape &shape) {
+    bool increasing = shape.step > 0;
+    if (not(increasing and (shape.pred == Instruction::lt or
+                            shape.pred == Instruction::le)) and
+        not(not increasing and (shape.pred == Instruction::gt or
+                                shape.pred == Instruction::ge)))
+        return false;
+    // 剩余迭代不少于 factor 次当且仅当 iv + (factor-1)*step 仍满足条件,
+    // 比较时改写为 iv pred limit - (factor-1)*step
+    long distance = long(factor_ - 1) * shape.step;
+    if (distance < INT_MIN or distance > INT_MAX)
+        return false;
+    auto header = shape.header;
+    auto func = header->get_parent();
+    BasicBlock *guard = nullptr;
+    Value *adjusted_limit = nullptr;
+    if (auto limit = dynamic_cast<ConstantInt *>(shape.limit)) {
+        long adjusted = limit->get_value() - distance;
+        if (adjusted < INT_MIN or adjusted > INT_MAX)
+            return false;
+        adjusted_limit = ConstantInt::get(int(adjusted), m_);
+    } else {
+        // 减法溢出时不进入展开后的循环
+        guard = BasicBlock::create(m_, "", func);
+        adjusted_limit = IBinaryInst::create_sub(
+            shape.limit, ConstantInt::get(int(distance), m_), guard);
+    }
+
+    auto unrolled_header = BasicBlock::create(m_, "", func);
+    auto entry = guard ? guard : unrolled_header;
+    ValueMap initial;
+    std::vector<PhiInst *> header_phis;
+    for (auto &instr : header->get_instructions()) {
+        if (not instr.is_phi())
+            break;
+        auto phi = static_cast<PhiInst *>(&instr);
+        header_phis.push_back(phi);
+        auto new_phi = PhiInst::create_phi(phi->get_type(), unrolled_header);
+        unrolled_header->add_instruction(new_phi);
+        initial[phi] = new_phi;
+    }
+    auto iv = initial[shape.iv];
+    auto cond = ICmpInst::create(shape.pred, iv, adjusted_limit, unrolled_header);
+
+    auto cloned = clone_iterations(loop, shape, factor_, initial, unrolled_header);
+    BranchInst::create_cond_br(cond, cloned.entry, header, unrolled_header);
+    if (guard) {
+        auto no_overflow = increasing
+                               ? ICmpInst::create_le(adjusted_limit,
+                                                     shape.limit, guard)
+                               : ICmpInst::create_ge(adjusted_limit,
+                                                     shape.limit, guard);
+        BranchInst::create_cond_br(no_overflow, unrolled_header, header, guard);
+    }
+
+    // 原循环作为余数循环, 从展开的循环或检查失败处进入
+    for (auto phi : header_phis) {
+        Value *init = nullptr;
+        for (unsigned i = 1; i < phi->get_num_operand(); i += 2) {
+            if (phi->get_operand(i) == shape.preheader) {
+                init = phi->get_operand(i - 1);
+                phi->set_operand(i - 1, initial[phi]);
+                phi->set_operand(i, unrolled_header);
+                break;
+            }
+        }
+        auto new_phi = static_cast<PhiInst *>(initial[phi]);
+        new_phi->add_phi_pair_operand(init, entry == guard ? guard : shape.preheader);
+        new_phi->add_phi_pair_operand(cloned.final_values.lookup(phi),
+                                      cloned.last_latch);
+        if (guard)
+            phi->add_phi_pair_operand(init, guard);
+    }
+    auto term = shape.preheader->get_terminator();
+    for (unsigned i = 0; i < term->get_num_operand(); ++i)
+        if (term->get_operand(i) == header)
+            term->set_operand(i, entry);
+    ++partial_count_;
+    return true;
+}
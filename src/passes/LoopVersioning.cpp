@@ -0,0 +1,250 @@
+#include "LoopVersioning.hpp"
+#include "Constant.hpp"
+#include "Function.hpp"
+#include "ValueRange.hpp"
+#include "logging.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <llvm/ADT/SmallPtrSet.h>
+
+void LoopVersioning::run() {
+    loop_info_ = std::make_unique<LoopInfo>(m_);
+    loop_info_->run();
+    for (auto &f : m_->get_functions()) {
+        if (f.is_declaration())
+            continue;
+        // 最内层循环互不重叠, 处理一个不影响其他循环
+        std::vector<Loop *> innermost;
+        std::vector<Loop *> work_list(
+            loop_info_->get_top_level_loops(&f).begin(),
+            loop_info_->get_top_level_loops(&f).end());
+        while (not work_list.empty()) {
+            auto loop = work_list.back();
+            work_list.pop_back();
+            if (loop->is_innermost())
+                innermost.push_back(loop);
+            for (auto sub_loop : loop->get_sub_loops())
+                work_list.push_back(sub_loop);
+        }
+        for (auto loop : innermost)
+            if (loop_info_->get_or_create_preheader(loop))
+                run_on_loop(loop);
+    }
+    LOG_INFO << "loop versioning versioned " << versioned_count_
+             << " loops and removed " << removed_count_
+             << " negative index checks";
+}
+
+void LoopVersioning::run_on_loop(Loop *loop) {
+    Loop::Bounds bounds;
+    if (not loop->get_bounds(bounds))
+        return;
+    bool increasing = bounds.step > 0;
+    if (not(increasing and (bounds.pred == Instruction::lt or
+                            bounds.pred == Instruction::le)) and
+        not(not increasing and (bounds.pred == Instruction::gt or
+                                bounds.pred == Instruction::ge)))
+        return;
+    auto checks = find_checks(loop, bounds);
+    std::vector<Guard> guards;
+    if (checks.empty() or not compute_guards(bounds, checks, guards))
+        return;
+
+    if (guards.empty()) {
+        for (auto &check : checks)
+            remove_neg_idx_check(check.bb, check.ok_bb, check.neg_bb);
+        removed_count_ += checks.size();
+        return;
+    }
+
+    // 两个版本在唯一的出口汇合, 要求出口只有 header 一个前驱且没有 phi
+    auto exit_pre_bbs = bounds.exit->get_pre_basic_blocks();
+    if (std::any_of(exit_pre_bbs.begin(), exit_pre_bbs.end(),
+                    [&](BasicBlock *pred) { return pred != bounds.header; }) or
+        bounds.exit->get_instructions().front().is_phi())
+        return;
+    unsigned size = 0;
+    for (auto bb : loop->get_blocks())
+        size += bb->get_num_of_instr();
+    if (size > kMaxLoopSize)
+        return;
+    version_loop(loop, bounds, checks, guards);
+    ++versioned_count_;
+    removed_count_ += checks.size();
+}
+
+std::vector<LoopVersioning::Check>
+LoopVersioning::find_checks(Loop *loop, const Loop::Bounds &bounds) {
+    std::vector<Check> checks;
+    for (auto bb : loop->get_blocks()) {
+        Value *idx;
+        BasicBlock *ok_bb, *neg_bb;
+        if (not match_neg_idx_check(bb, idx, ok_bb, neg_bb) or
+            not loop->contains(neg_bb))
+            continue;
+        // iv, iv + c, c + iv 或 iv - c
+        long offset = 0;
+        if (idx != bounds.iv) {
+            auto instr = dynamic_cast<IBinaryInst *>(idx);
+            if (instr == nullptr or not(instr->is_add() or instr->is_sub()))
+                continue;
+            auto lhs = instr->get_operand(0);
+            auto rhs = instr->get_operand(1);
+            if (instr->is_add() and rhs == bounds.iv)
+                std::swap(lhs, rhs);
+            auto c = dynamic_cast<ConstantInt *>(rhs);
+            if (lhs != bounds.iv or c == nullptr)
+                continue;
+            offset = instr->is_sub() ? -long(c->get_value()) : c->get_value();
+        }
+        checks.push_back({bb, ok_bb, neg_bb, offset});
+    }
+    return checks;
+}
+
+bool LoopVersioning::compute_guards(const Loop::Bounds &bounds,
+                                    const std::vector<Check> &checks,
+                                    std::vector<Guard> &guards) {
+    // 循环内 iv 的取值 [low, high] 需满足 low >= lower, high <= upper:
+    // iv + step 不回绕, 且对每个 c, iv + c 非负且不回绕
+    long lower = INT_MIN;
+    long upper = INT_MAX;
+    if (bounds.step > 0)
+        upper = long(INT_MAX) - bounds.step;
+    else
+        lower = long(INT_MIN) - bounds.step;
+    for (auto &check : checks) {
+        lower = std::max(lower, -check.offset);
+        if (check.offset > 0)
+            upper = std::min(upper, INT_MAX - check.offset);
+    }
+
+    // 递增时 low = init, high = limit - 1 (lt) 或 limit (le);
+    // 递减时 low = limit + 1 (gt) 或 limit (ge), high = init
+    std::vector<Guard> candidates;
+    if (bounds.step > 0) {
+        candidates.push_back({bounds.init, true, lower});
+        candidates.push_back({bounds.limit, false,
+                              bounds.pred == Instruction::lt ? upper + 1 : upper});
+    } else {
+        candidates.push_back({bounds.limit, true,
+                              bounds.pred == Instruction::gt ? lower - 1 : lower});
+        candidates.push_back({bounds.init, false, upper});
+    }
+    for (auto &guard : candidates) {
+        if (auto c = dynamic_cast<ConstantInt *>(guard.value)) {
+            if (guard.is_lower ? c->get_value() < guard.bound
+                               : c->get_value() > guard.bound)
+                return false;
+            continue;
+        }
+        if (guard.is_lower ? guard.bound > INT_MAX : guard.bound < INT_MIN)
+            return false;
+        if (guard.is_lower ? guard.bound > INT_MIN : guard.bound < INT_MAX)
+            guards.push_back(guard);
+    }
+    return true;
+}
+
+void LoopVersioning::version_loop(Loop *loop, const Loop::Bounds &bounds,
+                                  const std::vector<Check> &checks,
+                                  const std::vector<Guard> &guards) {
+    auto header = bounds.header;
+    auto preheader = bounds.preheader;
+    auto func = header->get_parent();
+
+    // 复制出不含这些检查的循环
+    llvm::DenseMap<BasicBlock *, BasicBlock *> check_ok;
+    llvm::SmallPtrSet<BasicBlock *, 8> removed_negs;
+    for (auto &check : checks) {
+        check_ok[check.bb] = check.ok_bb;
+        removed_negs.insert(check.neg_bb);
+    }
+    ValueMap map;
+    std::vector<BasicBlock *> blocks;
+    llvm::SmallPtrSet<BasicBlock *, 16> new_bbs;
+    for (auto bb : loop->get_blocks()) {
+        if (removed_negs.count(bb))
+            continue;
+        auto new_bb = BasicBlock::create(m_, "", func);
+        map[bb] = new_bb;
+        blocks.push_back(bb);
+        new_bbs.insert(new_bb);
+    }
+    for (auto bb : blocks) {
+        auto new_bb = static_cast<BasicBlock *>(map[bb]);
+        for (auto &instr : bb->get_instructions()) {
+            if (instr.is_br() and check_ok.count(bb)) {
+                BranchInst::create_br(check_ok[bb], new_bb);
+                continue;
+            }
+            map[&instr] = instr.clone(new_bb);
+        }
+    }
+    for (auto bb : blocks) {
+        for (auto &instr : static_cast<BasicBlock *>(map[bb])->get_instructions()) {
+            for (unsigned i = 0; i < instr.get_num_operand(); ++i) {
+                auto it = map.find(instr.get_operand(i));
+                if (it != map.end())
+                    instr.set_operand(i, it->second);
+            }
+        }
+    }
+    auto fast_header = static_cast<BasicBlock *>(map[header]);
+
+    // preheader 中依次检查各个条件, 都成立时进入副本
+    llvm::DenseMap<PhiInst *, Value *> init_values;
+    for (auto &instr : header->get_instructions()) {
+        if (not instr.is_phi())
+            break;
+        auto phi = static_cast<PhiInst *>(&instr);
+        for (auto [val, bb] : phi->get_phi_pairs())
+            if (bb == preheader)
+                init_values[phi] = val;
+    }
+    preheader->erase_instr(preheader->get_terminator());
+    auto guard_bb = preheader;
+    for (unsigned i = 0; i < guards.size(); ++i) {
+        auto &guard = guards[i];
+        auto cmp = ICmpInst::create(
+            guard.is_lower ? Instruction::ge : Instruction::le, guard.value,
+            ConstantInt::get(int(guard.bound), m_), guard_bb);
+        auto next_bb = i + 1 < guards.size()
+                           ? BasicBlock::create(m_, "", func)
+                           : fast_header;
+        BranchInst::create_cond_br(cmp, next_bb, header, guard_bb);
+        if (guard_bb != preheader)
+            for (auto [phi, val] : init_values)
+                phi->add_phi_pair_operand(val, guard_bb);
+        if (next_bb != fast_header)
+            guard_bb = next_bb;
+    }
+    for (auto &instr : fast_header->get_instructions()) {
+        if (not instr.is_phi())
+            break;
+        for (unsigned i = 1; i < instr.get_num_operand(); i += 2)
+            if (instr.get_operand(i) == preheader)
+                instr.set_operand(i, guard_bb);
+    }
+
+    // 循环外对 header 中值的使用改为两个版本的汇合
+    auto outside = [&](const Use *use) {
+        auto user = dynamic_cast<Instruction *>(use->val_);
+        return user and not loop->contains(user->get_parent()) and
+               not new_bbs.count(user->get_parent());
+    };
+    for (auto &instr : header->get_instructions()) {
+        auto &uses = instr.get_use_list();
+        if (instr.is_void() or
+            std::none_of(uses.begin(), uses.end(),
+                         [&](const Use &use) { return outside(&use); }))
+            continue;
+        auto phi = PhiInst::create_phi(instr.get_type(), bounds.exit);
+        bounds.exit->add_instr_begin(phi);
+        phi->add_phi_pair_operand(&instr, header);
+        phi->add_phi_pair_operand(map[&instr], fast_header);
+        instr.replace_use_with_if(
+            phi, [&](Use *use) { return use->val_ != phi and outside(use); });
+    }
+}
@@ -87,7 +87,8 @@ void Mem2Reg::rename(BasicBlock *bb) {
     // 步骤三：将 phi 指令作为 lval 的最新定值，lval 即是为局部变量 alloca
     // 出的地址空间
     for (auto &instr : bb->get_instructions()) {
-        if (instr.is_phi()) {
+        // 再次运行时跳过已有的 phi
+        if (instr.is_phi() and phi_lval.count(static_cast<PhiInst *>(&instr))) {
             auto l_val = phi_lval.at(static_cast<PhiInst *>(&instr));
             var_val_stack[l_val].push_back(&instr);
         }
@@ -120,7 +121,8 @@ void Mem2Reg::rename(BasicBlock *bb) {
     // 步骤六：为 lval 对应的 phi 指令参数补充完整
     for (auto succ_bb : bb->get_succ_basic_blocks()) {
         for (auto &instr : succ_bb->get_instructions()) {
-            if (instr.is_phi()) {
+            if (instr.is_phi() and
+                phi_lval.count(static_cast<PhiInst *>(&instr))) {
                 auto l_val = phi_lval.at(static_cast<PhiInst *>(&instr));
                 if (var_val_stack.find(l_val) != var_val_stack.end() &&
                     var_val_stack[l_val].size() != 0) {
@@ -145,7 +147,8 @@ void Mem2Reg::rename(BasicBlock *bb) {
             if (is_valid_ptr(l_val)) {
                 var_val_stack[l_val].pop_back();
             }
-        } else if (instr.is_phi()) {
+        } else if (instr.is_phi() and
+                   phi_lval.count(static_cast<PhiInst *>(&instr))) {
             auto l_val = phi_lval.at(static_cast<PhiInst *>(&instr));
             if (var_val_stack.find(l_val) != var_val_stack.end()) {
                 var_val_stack[l_val].pop_back();
@@ -0,0 +1,110 @@
+#include "Memoize.hpp"
+#include "Constant.hpp"
+#include "Function.hpp"
+#include "GlobalVariable.hpp"
+#include "logging.hpp"
+
+#include <algorithm>
+
+void Memoize::run() {
+    call_graph_ = std::make_unique<CallGraph>(m_);
+    call_graph_->run();
+    func_info_ = std::make_unique<FuncInfo>(m_);
+    func_info_->run();
+
+    std::vector<Function *> candidates;
+    for (auto &f : m_->get_functions())
+        if (not f.is_declaration() and can_memoize(&f))
+            candidates.push_back(&f);
+    for (auto func : candidates) {
+        memoize(func);
+        ++memoized_count_;
+    }
+    LOG_INFO << "memoization wrapped " << memoized_count_ << " functions";
+}
+
+bool Memoize::can_memoize(Function *func) {
+    if (func->get_name() == "main" or not func_info_->is_pure_function(func))
+        return false;
+    auto num_args = func->get_num_of_args();
+    if (num_args < 1 or num_args > 2)
+        return false;
+    for (auto &arg : func->get_args())
+        if (not arg.get_type()->is_int32_type())
+            return false;
+    auto ret_type = func->get_return_type();
+    if (not ret_type->is_int32_type() and not ret_type->is_float_type())
+        return false;
+
+    auto node = call_graph_->get_node(func);
+    auto calls = node->get_calls();
+    auto recursive_calls = std::count_if(calls.begin(), calls.end(), [&](CallInst *call) {
+        auto callee = call_graph_->get_node(call->get_operand(0)->as<Function>());
+        return not callee->is_external() and
+               callee->get_scc_id() == node->get_scc_id();
+    });
+    return recursive_calls >= 2;
+}
+
+void Memoize::memoize(Function *func) {
+    auto ret_type = func->get_return_type();
+    auto wrapper = Function::create(func->get_function_type(),
+                                    func->get_name() + "_memo", m_);
+    func->replace_all_use_with(wrapper);
+
+    auto num_args = func->get_num_of_args();
+    int size = num_args == 1 ? kOneArgSize : kTwoArgSize;
+    int table_size = num_args == 1 ? size : size * size;
+    auto int_type = m_->get_int32_type();
+    auto values_type = ArrayType::get(ret_type, table_size);
+    auto valid_type = ArrayType::get(int_type, table_size);
+    auto values = GlobalVariable::create(func->get_name() + "_memo_values", m_,
+                                         values_type, false,
+                                         ConstantZero::get(values_type, m_));
+    auto valid = GlobalVariable::create(func->get_name() + "_memo_valid", m_,
+                                        valid_type, false,
+                                        ConstantZero::get(valid_type, m_));
+
+    std::vector<Value *> args;
+    for (auto &arg : wrapper->get_args())
+        args.push_back(&arg);
+    auto zero = ConstantInt::get(0, m_);
+
+    // 参数越界时直接调用原函数
+    auto entry = BasicBlock::create(m_, "", wrapper);
+    auto slow_bb = BasicBlock::create(m_, "", wrapper);
+    ReturnInst::create_ret(CallInst::create_call(func, args, slow_bb), slow_bb);
+    auto bb = entry;
+    for (auto arg : args) {
+        auto lower_ok = BasicBlock::create(m_, "", wrapper);
+        BranchInst::create_cond_br(ICmpInst::create(Instruction::ge, arg, zero, bb),
+                                   lower_ok, slow_bb, bb);
+        auto upper_ok = BasicBlock::create(m_, "", wrapper);
+        BranchInst::create_cond_br(
+            ICmpInst::create(Instruction::lt, arg, ConstantInt::get(size, m_),
+                             lower_ok),
+            upper_ok, slow_bb, lower_ok);
+        bb = upper_ok;
+    }
+
+    // 查表, 命中时返回记录的值
+    Value *idx = args[0];
+    if (num_args == 2)
+        idx = IBinaryInst::create_add(
+            IBinaryInst::create_mul(args[0], ConstantInt::get(size, m_), bb),
+            args[1], bb);
+    auto valid_ptr = GetElementPtrInst::create_gep(valid, {zero, idx}, bb);
+    auto value_ptr = GetElementPtrInst::create_gep(values, {zero, idx}, bb);
+    auto hit_bb = BasicBlock::create(m_, "", wrapper);
+    auto miss_bb = BasicBlock::create(m_, "", wrapper);
+    BranchInst::create_cond_br(
+        ICmpInst::create(Instruction::ne, LoadInst::create_load(valid_ptr, bb),
+                         zero, bb),
+        hit_bb, miss_bb, bb);
+    ReturnInst::create_ret(LoadInst::create_load(value_ptr, hit_bb), hit_bb);
+
+    auto result = CallInst::create_call(func, args, miss_bb);
+    StoreInst::create_store(result, value_ptr, miss_bb);
+    StoreInst::create_store(ConstantInt::get(1, m_), valid_ptr, miss_bb);
+    ReturnInst::create_ret(result, miss_bb);
+}
@@ -0,0 +1,32 @@
+#include "RangeCheckElim.hpp"
+#include "Constant.hpp"
+#include "Function.hpp"
+#include "logging.hpp"
+
+#include <vector>
+
+void RangeCheckElim::run() {
+    value_range_ = std::make_unique<ValueRange>(m_);
+    value_range_->run();
+    for (auto &f : m_->get_functions()) {
+        if (f.is_declaration())
+            continue;
+        std::vector<BasicBlock *> check_bbs;
+        for (auto &bb : f.get_basic_blocks()) {
+            Value *idx;
+            BasicBlock *ok_bb, *neg_bb;
+            if (match_neg_idx_check(&bb, idx, ok_bb, neg_bb) and
+                value_range_->get_range(idx, &bb).lo >= 0)
+                check_bbs.push_back(&bb);
+        }
+        for (auto bb : check_bbs) {
+            Value *idx;
+            BasicBlock *ok_bb, *neg_bb;
+            match_neg_idx_check(bb, idx, ok_bb, neg_bb);
+            remove_neg_idx_check(bb, ok_bb, neg_bb);
+        }
+        removed_count_ += check_bbs.size();
+    }
+    LOG_INFO << "range check elimination removed " << removed_count_
+             << " negative index checks";
+}
@@ -0,0 +1,161 @@
+#include "RedundantLoadElim.hpp"
+#include "Function.hpp"
+#include "logging.hpp"
+
+#include <algorithm>
+
+void RedundantLoadElim::run() {
+    alias_analysis_ = std::make_unique<AliasAnalysis>(m_);
+    alias_analysis_->run();
+    for (auto &f : m_->get_functions()) {
+        if (f.is_declaration())
+            continue;
+        run_on_func(&f);
+    }
+    LOG_INFO << "redundant load elimination removed " << load_count_
+             << " loads, forwarded " << forward_count_
+             << " stores and inserted " << phi_count_ << " phis";
+}
+
+std::vector<BasicBlock *>
+RedundantLoadElim::get_reverse_post_order(Function *func) {
+    std::vector<BasicBlock *> post_order;
+    llvm::DenseMap<BasicBlock *, bool> visited;
+    // 显式栈上的 DFS, 第二项是下一个要访问的后继
+    std::vector<std::pair<BasicBlock *, unsigned>> stack;
+    stack.push_back({func->get_entry_block(), 0});
+    visited[func->get_entry_block()] = true;
+    while (not stack.empty()) {
+        auto &[bb, next] = stack.back();
+        auto succs = bb->get_succ_basic_blocks();
+        if (next == succs.size()) {
+            post_order.push_back(bb);
+            stack.pop_back();
+            continue;
+        }
+        auto succ = succs[next++];
+        if (not visited[succ]) {
+            visited[succ] = true;
+            stack.push_back({succ, 0});
+        }
+    }
+    std::reverse(post_order.begin(), post_order.end());
+    return post_order;
+}
+
+void RedundantLoadElim::run_on_func(Function *func) {
+    rpo_index_.clear();
+    end_states_.clear();
+    auto order = get_reverse_post_order(func);
+    for (unsigned i = 0; i < order.size(); ++i)
+        rpo_index_[order[i]] = i;
+    for (auto bb : order) {
+        auto state = merge_predecessors(bb);
+        process_block(bb, state);
+        end_states_[bb] = std::move(state);
+    }
+}
+
+RedundantLoadElim::State RedundantLoadElim::merge_predecessors(BasicBlock *bb) {
+    std::vector<BasicBlock *> preds;
+    // 有不可达或重复的前驱时无法插入 phi
+    bool can_insert_phi = true;
+    for (auto pred : bb->get_pre_basic_blocks()) {
+        if (not rpo_index_.count(pred)) {
+            can_insert_phi = false;
+            continue;
+        }
+        // 回边
+        if (not end_states_.count(pred))
+            return {};
+        if (std::find(preds.begin(), preds.end(), pred) != preds.end()) {
+            can_insert_phi = false;
+            continue;
+        }
+        preds.push_back(pred);
+    }
+    if (preds.empty())
+        return {};
+    if (preds.size() == 1)
+        return end_states_[preds.front()];
+
+    State state;
+    for (auto &entry : end_states_[preds.front()]) {
+        std::vector<Value *> vals{entry.val};
+        bool from_store = entry.from_store;
+        for (unsigned i = 1; i < preds.size(); ++i) {
+            auto &pred_state = end_states_[preds[i]];
+            auto it = std::find_if(
+                pred_state.begin(), pred_state.end(),
+                [&](const Entry &other) { return other.ptr == entry.ptr; });
+            if (it == pred_state.end())
+                break;
+            vals.push_back(it->val);
+            from_store = from_store and it->from_store;
+        }
+        if (vals.size() != preds.size())
+            continue;
+        if (std::all_of(vals.begin(), vals.end(),
+                        [&](Value *val) { return val == vals.front(); })) {
+            state.push_back({entry.ptr, entry.val, from_store});
+            continue;
+        }
+        if (not can_insert_phi)
+            continue;
+        auto phi = PhiInst::create_phi(entry.val->get_type(), bb);
+        bb->add_instr_begin(phi);
+        for (unsigned i = 0; i < preds.size(); ++i)
+            phi->add_phi_pair_operand(vals[i], preds[i]);
+        state.push_back({entry.ptr, phi, from_store});
+        ++phi_count_;
+    }
+    return state;
+}
+
+void RedundantLoadElim::process_block(BasicBlock *bb, State &state) {
+    std::vector<Instruction *> wait_delete;
+    for (auto &instr : bb->get_instructions()) {
+        if (instr.is_load()) {
+            auto load = static_cast<LoadInst *>(&instr);
+            auto ptr = load->get_lval();
+            auto it = std::find_if(state.begin(), state.end(), [&](Entry &entry) {
+                return entry.val->get_type() == load->get_type() and
+                       alias_analysis_->must_alias(entry.ptr, ptr);
+            });
+            if (it != state.end()) {
+                load->replace_all_use_with(it->val);
+                wait_delete.push_back(load);
+                ++(it->from_store ? forward_count_ : load_count_);
+                continue;
+            }
+            if (state.size() == kMaxEntries)
+                state.erase(state.begin());
+            state.push_back({ptr, load, false});
+        } else if (instr.is_store()) {
+            auto store = static_cast<StoreInst *>(&instr);
+            kill(state, store->get_lval());
+            if (state.size() == kMaxEntries)
+                state.erase(state.begin());
+            state.push_back({store->get_lval(), store->get_rval(), true});
+        } else if (instr.is_call()) {
+            auto call = static_cast<CallInst *>(&instr);
+            state.erase(std::remove_if(state.begin(), state.end(),
+                                       [&](Entry &entry) {
+                                           return alias_analysis_->call_may_modify(
+                                               call, entry.ptr);
+                                       }),
+                        state.end());
+        }
+    }
+    for (auto instr : wait_delete)
+        bb->erase_instr(instr);
+}
+
+void RedundantLoadElim::kill(State &state, Value *ptr) {
+    state.erase(std::remove_if(state.begin(), state.end(),
+                               [&](Entry &entry) {
+                                   return alias_analysis_->may_alias(entry.ptr,
+                                                                     ptr);
+                               }),
+                state.end());
+}
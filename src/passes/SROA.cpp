@@ -0,0 +1,76 @@
+#include "SROA.hpp"
+#include "Constant.hpp"
+#include "Function.hpp"
+#include "logging.hpp"
+
+void SROA::run() {
+    for (auto &f : m_->get_functions()) {
+        if (f.is_declaration())
+            continue;
+        run_on_func(&f);
+    }
+    LOG_INFO << "scalar replacement split " << split_count_ << " arrays";
+}
+
+void SROA::run_on_func(Function *func) {
+    std::vector<AllocaInst *> allocas;
+    for (auto &bb : func->get_basic_blocks())
+        for (auto &instr : bb.get_instructions())
+            if (instr.is_alloca() and can_split(static_cast<AllocaInst *>(&instr)))
+                allocas.push_back(static_cast<AllocaInst *>(&instr));
+    for (auto alloca : allocas) {
+        split(alloca);
+        ++split_count_;
+    }
+}
+
+bool SROA::can_split(AllocaInst *alloca) {
+    auto type = alloca->get_alloca_type();
+    if (not type->is_array_type())
+        return false;
+    auto array_type = static_cast<ArrayType *>(type);
+    if (array_type->get_num_of_elements() > kMaxElements)
+        return false;
+    for (auto &use : alloca->get_use_list()) {
+        auto gep = dynamic_cast<GetElementPtrInst *>(use.val_);
+        if (gep == nullptr or use.arg_no_ != 0 or gep->get_num_operand() != 3)
+            return false;
+        auto zero = dynamic_cast<ConstantInt *>(gep->get_operand(1));
+        auto idx = dynamic_cast<ConstantInt *>(gep->get_operand(2));
+        if (zero == nullptr or zero->get_value() != 0 or idx == nullptr or
+            idx->get_value() < 0 or
+            idx->get_value() >= int(array_type->get_num_of_elements()))
+            return false;
+        for (auto &gep_use : gep->get_use_list()) {
+            auto user = static_cast<Instruction *>(gep_use.val_);
+            if (not(user->is_load() or (user->is_store() and gep_use.arg_no_ == 1)))
+                return false;
+        }
+    }
+    return true;
+}
+
+void SROA::split(AllocaInst *alloca) {
+    auto array_type = static_cast<ArrayType *>(alloca->get_alloca_type());
+    auto elem_type = array_type->get_element_type();
+    auto entry = alloca->get_parent()->get_parent()->get_entry_block();
+    Value *zero = elem_type->is_float_type()
+                      ? static_cast<Value *>(ConstantFP::get(0.0, m_))
+                      : ConstantInt::get(0, m_);
+    std::vector<AllocaInst *> elems;
+    for (unsigned i = 0; i < array_type->get_num_of_elements(); ++i) {
+        auto elem = AllocaInst::create_alloca(elem_type, nullptr);
+        entry->add_instr_begin(StoreInst::create_store(zero, elem, nullptr));
+        entry->add_instr_begin(elem);
+        elems.push_back(elem);
+    }
+    std::vector<Instruction *> geps;
+    for (auto &use : alloca->get_use_list())
+        geps.push_back(static_cast<Instruction *>(use.val_));
+    for (auto gep : geps) {
+        auto idx = static_cast<ConstantInt *>(gep->get_operand(2))->get_value();
+        gep->replace_all_use_with(elems[idx]);
+        gep->get_parent()->erase_instr(gep);
+    }
+    alloca->get_parent()->erase_instr(alloca);
+}
@@ -0,0 +1,151 @@
+#include "TailRecursionElim.hpp"
+#include "AliasAnalysis.hpp"
+#include "Constant.hpp"
+#include "Function.hpp"
+#include "logging.hpp"
+
+#include <iterator>
+
+void TailRecursionElim::run() {
+    for (auto &f : m_->get_functions()) {
+        if (f.is_declaration())
+            continue;
+        run_on_func(&f);
+    }
+    LOG_INFO << "tail recursion elimination removed " << eliminated_count_
+             << " tail calls";
+}
+
+void TailRecursionElim::run_on_func(Function *func) {
+    std::vector<TailCall> tail_calls;
+    // 累加器使用的运算, 由第一个需要累加器的调用点决定
+    std::optional<Instruction::OpID> acc_op;
+    for (auto &bb : func->get_basic_blocks()) {
+        TailCall tail_call;
+        if (not match_tail_call(func, &bb, tail_call))
+            continue;
+        if (tail_call.acc_op) {
+            if (not acc_op)
+                acc_op = tail_call.acc_op->get_instr_type();
+            else if (tail_call.acc_op->get_instr_type() != acc_op)
+                continue;
+        }
+        tail_calls.push_back(tail_call);
+    }
+    if (tail_calls.empty())
+        return;
+    eliminate(func, tail_calls, acc_op);
+    eliminated_count_ += tail_calls.size();
+}
+
+bool TailRecursionElim::match_tail_call(Function *func, BasicBlock *bb,
+                                        TailCall &tail_call) {
+    auto ret = dynamic_cast<ReturnInst *>(bb->get_terminator());
+    if (ret == nullptr or bb->get_num_of_instr() < 2 or
+        (bb->get_pre_basic_blocks().empty() and bb != func->get_entry_block()))
+        return false;
+    // 倒数第二条指令是调用, 或是以调用结果为操作数的 add/mul
+    auto it = std::prev(ret->getIterator());
+    tail_call = {bb, nullptr, nullptr};
+    if (auto op = dynamic_cast<IBinaryInst *>(&*it);
+        op and (op->is_add() or op->is_mul()) and not ret->is_void_ret() and
+        ret->get_operand(0) == op and op->get_use_list().size() == 1) {
+        if (it == bb->get_instructions().begin())
+            return false;
+        tail_call.acc_op = op;
+        --it;
+    }
+    auto call = dynamic_cast<CallInst *>(&*it);
+    if (call == nullptr or call->get_operand(0) != func)
+        return false;
+    tail_call.call = call;
+    if (tail_call.acc_op) {
+        auto lhs = tail_call.acc_op->get_operand(0);
+        auto rhs = tail_call.acc_op->get_operand(1);
+        if (lhs == rhs or (lhs != call and rhs != call) or
+            call->get_use_list().size() != 1)
+            return false;
+    } else if (not ret->is_void_ret() and ret->get_operand(0) != call) {
+        return false;
+    }
+    // 被调用的一层可能访问调用者的局部数组, 它们在循环中是同一块内存
+    for (unsigned i = 1; i < call->get_num_operand(); ++i)
+        if (dynamic_cast<AllocaInst *>(
+                AliasAnalysis::get_underlying_object(call->get_operand(i))))
+            return false;
+    return true;
+}
+
+void TailRecursionElim::eliminate(Function *func,
+                                  const std::vector<TailCall> &tail_calls,
+                                  std::optional<Instruction::OpID> acc_op) {
+    // 新的入口块放在最前面, 原入口块中的 alloca 移到其中
+    auto header = func->get_entry_block();
+    auto entry = BasicBlock::create(m_, "", func);
+    auto &blocks = func->get_basic_blocks();
+    blocks.splice(blocks.begin(), blocks, entry->getIterator());
+    std::vector<Instruction *> allocas;
+    for (auto &instr : header->get_instructions())
+        if (instr.is_alloca())
+            allocas.push_back(&instr);
+    for (auto alloca : allocas) {
+        header->remove_instr(alloca);
+        entry->add_instruction(alloca);
+    }
+    BranchInst::create_br(header, entry);
+
+    std::vector<PhiInst *> arg_phis;
+    for (auto &arg : func->get_args()) {
+        auto phi = PhiInst::create_phi(arg.get_type(), header);
+        header->add_instr_begin(phi);
+        arg.replace_all_use_with(phi);
+        phi->add_phi_pair_operand(&arg, entry);
+        arg_phis.push_back(phi);
+    }
+    PhiInst *acc = nullptr;
+    if (acc_op) {
+        acc = PhiInst::create_phi(func->get_return_type(), header);
+        header->add_instr_begin(acc);
+        acc->add_phi_pair_operand(
+            ConstantInt::get(*acc_op == Instruction::add ? 0 : 1, m_), entry);
+    }
+    auto create_acc_op = [&](Value *val, BasicBlock *bb) {
+        auto instr = *acc_op == Instruction::add
+                         ? IBinaryInst::create_add(acc, val, nullptr)
+                         : IBinaryInst::create_mul(acc, val, nullptr);
+        bb->insert_before(bb->get_terminator(), instr);
+        return instr;
+    };
+
+    for (auto &tail_call : tail_calls) {
+        auto bb = tail_call.bb;
+        std::vector<Value *> args(tail_call.call->get_operands().begin() + 1,
+                                  tail_call.call->get_operands().end());
+        Value *next_acc = acc;
+        if (auto op = tail_call.acc_op) {
+            // 参数已替换为 phi, 这里再取另一个操作数
+            auto val = op->get_operand(0) == tail_call.call ? op->get_operand(1)
+                                                            : op->get_operand(0);
+            next_acc = create_acc_op(val, bb);
+        }
+        bb->erase_instr(bb->get_terminator());
+        if (tail_call.acc_op)
+            bb->erase_instr(tail_call.acc_op);
+        bb->erase_instr(tail_call.call);
+        BranchInst::create_br(header, bb);
+        for (unsigned i = 0; i < args.size(); ++i)
+            arg_phis[i]->add_phi_pair_operand(args[i], bb);
+        if (acc)
+            acc->add_phi_pair_operand(next_acc, bb);
+    }
+
+    // 其余的返回值要与累加器合并
+    if (acc == nullptr)
+        return;
+    for (auto &bb : blocks) {
+        auto ret = dynamic_cast<ReturnInst *>(bb.get_terminator());
+        if (ret == nullptr or ret->is_void_ret())
+            continue;
+        ret->set_operand(0, create_acc_op(ret->get_operand(0), &bb));
+    }
+}
@@ -0,0 +1,364 @@
+#include "ValueRange.hpp"
+#include "Constant.hpp"
+#include "Function.hpp"
+
+#include <algorithm>
+
+namespace {
+
+// 过程间传递的轮数上限
+constexpr int kMaxRounds = 3;
+// phi 的区间扩大超过该次数后放宽到 i32 的边界
+constexpr int kWidenThreshold = 2;
+
+using Range = ValueRange::Range;
+
+Range make_range(long lo, long hi) {
+    // 超出 i32 说明可能回绕
+    if (lo < INT_MIN or hi > INT_MAX)
+        return Range::full();
+    return {lo, hi};
+}
+
+} // namespace
+
+Range Range::join(const Range &other) const {
+    if (is_empty())
+        return other;
+    if (other.is_empty())
+        return *this;
+    return {std::min(lo, other.lo), std::max(hi, other.hi)};
+}
+
+Range Range::intersect(const Range &other) const {
+    return {std::max(lo, other.lo), std::min(hi, other.hi)};
+}
+
+void ValueRange::run() {
+    dominators_ = std::make_unique<Dominators>(m_);
+    conditions_.clear();
+    block_condition_.clear();
+    block_order_.clear();
+    arg_ranges_.clear();
+    ret_ranges_.clear();
+    for (auto &f : m_->get_functions()) {
+        if (f.is_declaration())
+            continue;
+        prepare_func(&f);
+    }
+    for (int round = 0; round < kMaxRounds; ++round) {
+        if (not run_round())
+            break;
+    }
+}
+
+void ValueRange::run_on_func(Function *func) {
+    if (dominators_ == nullptr)
+        dominators_ = std::make_unique<Dominators>(m_);
+    conditions_.clear();
+    block_condition_.clear();
+    block_order_.clear();
+    arg_ranges_.clear();
+    ret_ranges_.clear();
+    ranges_.clear();
+    widen_count_.clear();
+    prepare_func(func);
+    analyze_func(func);
+}
+
+void ValueRange::prepare_func(Function *func) {
+    dominators_->run_on_func(func);
+    auto &order = block_order_[func];
+    order = dominators_->get_dom_dfs_order();
+    for (auto bb : order) {
+        int cond = -1;
+        if (bb != func->get_entry_block()) {
+            auto idom = dominators_->get_idom(bb);
+            cond = block_condition_.lookup(idom);
+            // 唯一前驱的跳转条件在 bb 支配的块中都成立
+            auto pre_bbs = bb->get_pre_basic_blocks();
+            auto br = dynamic_cast<BranchInst *>(idom->get_terminator());
+            bool single_pred = std::all_of(
+                pre_bbs.begin(), pre_bbs.end(),
+                [&](BasicBlock *pred) { return pred == idom; });
+            if (single_pred and br and br->is_cond_br() and
+                br->get_successor(0) != br->get_successor(1)) {
+                if (auto cmp = dynamic_cast<ICmpInst *>(br->get_condition()))
+                    cond = push_condition(cmp, br->get_successor(0) == bb, cond);
+            }
+        }
+        block_condition_[bb] = cond;
+    }
+}
+
+int ValueRange::push_condition(ICmpInst *cmp, bool taken, int parent) {
+    conditions_.push_back({cmp, taken, parent});
+    return conditions_.size() - 1;
+}
+
+bool ValueRange::run_round() {
+    ranges_.clear();
+    widen_count_.clear();
+    for (auto &f : m_->get_functions()) {
+        if (f.is_declaration())
+            continue;
+        analyze_func(&f);
+    }
+
+    // 用本轮的结果计算参数与返回值的区间
+    llvm::DenseMap<Argument *, Range> arg_ranges;
+    llvm::DenseMap<Function *, Range> ret_ranges;
+    for (auto &f : m_->get_functions()) {
+        if (f.is_declaration())
+            continue;
+        std::vector<Range> args(f.get_num_of_args(), Range::empty());
+        bool all_known = not f.get_use_list().empty();
+        for (auto &use : f.get_use_list()) {
+            auto call = dynamic_cast<CallInst *>(use.val_);
+            if (call == nullptr or use.arg_no_ != 0) {
+                all_known = false;
+                break;
+            }
+            auto bb = call->get_parent();
+            if (not block_condition_.count(bb))
+                continue;
+            for (unsigned i = 0; i < args.size(); ++i)
+                args[i] = args[i].join(get_range(call->get_operand(i + 1), bb));
+        }
+        unsigned i = 0;
+        for (auto &arg : f.get_args()) {
+            if (all_known and arg.get_type()->is_int32_type() and
+                not args[i].is_empty())
+                arg_ranges[&arg] = args[i];
+            ++i;
+        }
+
+        if (not f.get_return_type()->is_int32_type())
+            continue;
+        auto ret = Range::empty();
+        for (auto bb : block_order_[&f]) {
+            auto term = bb->get_terminator();
+            if (term and term->is_ret())
+                ret = ret.join(get_range(term->get_operand(0), bb));
+        }
+        if (not ret.is_empty())
+            ret_ranges[&f] = ret;
+    }
+
+    bool changed = arg_ranges.size() != arg_ranges_.size() or
+                   ret_ranges.size() != ret_ranges_.size();
+    for (auto [arg, range] : arg_ranges)
+        changed = changed or arg_ranges_.lookup(arg) != range;
+    for (auto [func, range] : ret_ranges)
+        changed = changed or ret_ranges_.lookup(func) != range;
+    arg_ranges_ = std::move(arg_ranges);
+    ret_ranges_ = std::move(ret_ranges);
+    return changed;
+}
+
+void ValueRange::analyze_func(Function *func) {
+    auto &order = block_order_[func];
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (auto bb : order) {
+            for (auto &instr : bb->get_instructions()) {
+                if (not instr.get_type()->is_int32_type())
+                    continue;
+                auto range = evaluate(&instr);
+                auto it = ranges_.find(&instr);
+                if (it != ranges_.end()) {
+                    auto old = it->second;
+                    range = range.join(old);
+                    if (range == old)
+                        continue;
+                    if (instr.is_phi() and
+                        ++widen_count_[&instr] > kWidenThreshold) {
+                        if (range.lo < old.lo)
+                            range.lo = INT_MIN;
+                        if (range.hi > old.hi)
+                            range.hi = INT_MAX;
+                    }
+                } else if (range.is_empty()) {
+                    continue;
+                }
+                ranges_[&instr] = range;
+                changed = true;
+            }
+        }
+    }
+}
+
+Range ValueRange::evaluate(Instruction *instr) {
+    auto bb = instr->get_parent();
+    if (instr->is_phi()) {
+        auto range = Range::empty();
+        for (auto [val, pred] : static_cast<PhiInst *>(instr)->get_phi_pairs()) {
+            auto it = block_condition_.find(pred);
+            if (it == block_condition_.end())
+                continue;
+            auto incoming = refine(val, get_base_range(val), it->second);
+            auto br = dynamic_cast<BranchInst *>(pred->get_terminator());
+            if (br and br->is_cond_br() and
+                br->get_successor(0) != br->get_successor(1)) {
+                if (auto cmp = dynamic_cast<ICmpInst *>(br->get_condition()))
+                    incoming = refine_by(val, incoming, cmp,
+                                         br->get_successor(0) == bb);
+            }
+            range = range.join(incoming);
+        }
+        return range;
+    }
+    if (instr->is_zext())
+        return {0, 1};
+    if (instr->is_call()) {
+        auto callee = static_cast<Function *>(instr->get_operand(0));
+        return ret_ranges_.lookup(callee);
+    }
+    if (not instr->is_add() and not instr->is_sub() and not instr->is_mul() and
+        not instr->is_div())
+        return Range::full();
+
+    auto lhs = get_range(instr->get_operand(0), bb);
+    auto rhs = get_range(instr->get_operand(1), bb);
+    if (lhs.is_empty() or rhs.is_empty())
+        return Range::empty();
+    if (instr->is_add())
+        return make_range(lhs.lo + rhs.lo, lhs.hi + rhs.hi);
+    if (instr->is_sub())
+        return make_range(lhs.lo - rhs.hi, lhs.hi - rhs.lo);
+    if (instr->is_mul()) {
+        long products[] = {lhs.lo * rhs.lo, lhs.lo * rhs.hi, lhs.hi * rhs.lo,
+                           lhs.hi * rhs.hi};
+        return make_range(*std::min_element(products, products + 4),
+                          *std::max_element(products, products + 4));
+    }
+    // 除以正数时商随被除数单调不减
+    if (rhs.lo > 0) {
+        long quotients[] = {lhs.lo / rhs.lo, lhs.lo / rhs.hi, lhs.hi / rhs.lo,
+                            lhs.hi / rhs.hi};
+        return make_range(*std::min_element(quotients, quotients + 4),
+                          *std::max_element(quotients, quotients + 4));
+    }
+    return Range::full();
+}
+
+Range ValueRange::get_base_range(Value *val) {
+    if (auto c = dynamic_cast<ConstantInt *>(val))
+        return Range::constant(c->get_value());
+    if (auto arg = dynamic_cast<Argument *>(val))
+        return arg_ranges_.lookup(arg);
+    if (dynamic_cast<Instruction *>(val)) {
+        // 尚未求出的值暂时为空集
+        auto it = ranges_.find(val);
+        return it != ranges_.end() ? it->second : Range::empty();
+    }
+    return Range::full();
+}
+
+Range ValueRange::get_range(Value *val, BasicBlock *bb) {
+    auto range = get_base_range(val);
+    auto it = block_condition_.find(bb);
+    if (it == block_condition_.end())
+        return range;
+    return refine(val, range, it->second);
+}
+
+Range ValueRange::refine(Value *val, Range range, int cond) const {
+    if (dynamic_cast<Constant *>(val))
+        return range;
+    for (; cond != -1 and not range.is_empty();
+         cond = conditions_[cond].parent)
+        range = refine_by(val, range, conditions_[cond].cmp,
+                          conditions_[cond].taken);
+    return range;
+}
+
+Range ValueRange::refine_by(Value *val, Range range, ICmpInst *cmp,
+                            bool taken) const {
+    auto pred = cmp->get_instr_type();
+    Value *other = nullptr;
+    if (cmp->get_operand(0) == val) {
+        other = cmp->get_operand(1);
+    } else if (cmp->get_operand(1) == val) {
+        other = cmp->get_operand(0);
+        pred = ICmpInst::get_swapped_predicate(pred);
+    } else {
+        return range;
+    }
+    if (not taken)
+        pred = ICmpInst::get_inverse_predicate(pred);
+
+    Range bound = Range::full();
+    if (auto c = dynamic_cast<ConstantInt *>(other)) {
+        bound = Range::constant(c->get_value());
+    } else if (auto arg = dynamic_cast<Argument *>(other)) {
+        bound = arg_ranges_.lookup(arg);
+    } else if (dynamic_cast<Instruction *>(other)) {
+        auto it = ranges_.find(other);
+        // 另一侧尚未求出时, 这里也视为尚未执行到
+        if (it == ranges_.end())
+            return Range::empty();
+        bound = it->second;
+    }
+    switch (pred) {
+    case Instruction::lt:
+        range.hi = std::min(range.hi, bound.hi - 1);
+        break;
+    case Instruction::le:
+        range.hi = std::min(range.hi, bound.hi);
+        break;
+    case Instruction::gt:
+        range.lo = std::max(range.lo, bound.lo + 1);
+        break;
+    case Instruction::ge:
+        range.lo = std::max(range.lo, bound.lo);
+        break;
+    case Instruction::eq:
+        range = range.intersect(bound);
+        break;
+    default:
+        if (bound.lo == bound.hi and range.lo == bound.lo)
+            ++range.lo;
+        else if (bound.lo == bound.hi and range.hi == bound.hi)
+            --range.hi;
+        break;
+    }
+    return range;
+}
+
+bool match_neg_idx_check(BasicBlock *bb, Value *&idx, BasicBlock *&ok_bb,
+                         BasicBlock *&neg_bb) {
+    auto br = dynamic_cast<BranchInst *>(bb->get_terminator());
+    if (br == nullptr or not br->is_cond_br())
+        return false;
+    auto cmp = dynamic_cast<ICmpInst *>(br->get_condition());
+    auto zero = cmp ? dynamic_cast<ConstantInt *>(cmp->get_operand(1)) : nullptr;
+    if (zero == nullptr or cmp->get_instr_type() != Instruction::ge or
+        zero->get_value() != 0)
+        return false;
+    ok_bb = br->get_successor(0);
+    neg_bb = br->get_successor(1);
+    // idx.neg 只有检查所在的块一个前驱, 只含异常调用和跳回 idx.ok
+    if (neg_bb == ok_bb or neg_bb->get_pre_basic_blocks().size() != 1 or
+        neg_bb->get_num_of_instr() != 2)
+        return false;
+    auto call = dynamic_cast<CallInst *>(&neg_bb->get_instructions().front());
+    auto jump = dynamic_cast<BranchInst *>(neg_bb->get_terminator());
+    if (call == nullptr or call->get_operand(0)->get_name() != "neg_idx_except" or
+        jump == nullptr or jump->is_cond_br() or jump->get_successor(0) != ok_bb)
+        return false;
+    idx = cmp->get_operand(0);
+    return true;
+}
+
+void remove_neg_idx_check(BasicBlock *bb, BasicBlock *ok_bb, BasicBlock *neg_bb) {
+    auto br = bb->get_terminator();
+    auto cmp = static_cast<Instruction *>(br->get_operand(0));
+    bb->erase_instr(br);
+    BranchInst::create_br(ok_bb, bb);
+    if (cmp->get_use_list().empty())
+        cmp->get_parent()->erase_instr(cmp);
+    neg_bb->erase_from_parent();
+    delete neg_bb;
+}
@@ -50,7 +50,7 @@ lv0_2 = {
     "num_comp2": (1.5, False),
 }
 
-# 31
+# 36
 lv1 = {
     "assign_int_var_local": (1, False),
     "assign_int_array_local": (2, False),
@@ -68,6 +68,11 @@ lv1 = {
     "negidx_intfuncall": (1, False),
     "negidx_floatfuncall": (1, False),
     "negidx_voidfuncall": (1, False),
+    "negidx_loop_cond": (1, True),
+    "unroll_remainder": (1, True),
+    "negidx_versioned_loop": (1, True),
+    "rle_join": (1, True),
+    "dse_overwrite": (1, True),
     "selection1": (1.5, False),
     "selection2": (1.5, False),
     "selection3": (1.5, False),
@@ -78,7 +83,7 @@ lv1 = {
     "transfer_int_to_float": (1, False),
 }
 
-# 23
+# 27
 lv2 = {
     "funcall_chain": (2, False),
     "assign_chain": (2, False),
@@ -86,6 +91,8 @@ lv2 = {
     "funcall_int_array": (2, False),
     "funcall_float_array": (2, False),
     "funcall_array_array": (2, False),
+    "funcall_array_reduce": (2, False),
+    "tre_accumulator": (2, True),
     "return_in_middle1": (2, False),
     "return_in_middle2": (2, False),
     "funcall_type_mismatch1": (2, False),
@@ -120,6 +127,20 @@ def eval():
                 opt_flags.append("-func-inline")
             elif arg == "const-prop":
                 opt_flags.append("-const-prop")
+            elif arg == "licm":
+                opt_flags.append("-licm")
+            elif arg == "gvn":
+                opt_flags.append("-gvn")
+            elif arg == "unroll":
+                opt_flags.append("-unroll")
+            elif arg == "loop-version":
+                opt_flags.append("-loop-version")
+            elif arg == "rle":
+                opt_flags.append("-rle")
+            elif arg == "dse":
+                opt_flags.append("-dse")
+            elif arg == "tre":
+                opt_flags.append("-tre")
 
     f = open("eval_result", 'w')
     EXE_PATH = "../../../build/cminusfc"
@@ -8,6 +8,13 @@ show_usage() {
     echo "  dce         - Run with Dead Code Elimination"
     echo "  func-inline - Run with Function Inline"
     echo "  const-prop  - Run with Constant Propagation"
+    echo "  licm        - Run with Loop Invariant Code Motion"
+    echo "  gvn         - Run with Global Value Numbering"
+    echo "  unroll      - Run with Loop Unrolling (needs dce)"
+    echo "  loop-version - Run with Loop Versioning for negative index checks"
+    echo "  rle         - Run with Redundant Load Elimination (needs dce)"
+    echo "  dse         - Run with Dead Store Elimination (needs dce)"
+    echo "  tre         - Run with Tail Recursion Elimination (needs dce)"
     echo "Example:"
     echo "  $0 dce func-inline      - Run with both DCE and Function Inline"
     echo "  $0 dce const-prop       - Run with both DCE and Constant Propagation"
@@ -26,7 +33,7 @@ fi
 opts=""
 for arg in "$@"; do
     case $arg in
-        "dce"|"func-inline"|"const-prop")
+        "dce"|"func-inline"|"const-prop"|"licm"|"gvn"|"unroll"|"loop-version"|"rle"|"dse"|"tre")
             opts="$opts $arg"
             ;;
         *)
@@ -0,0 +1,338 @@
+// cminus-gen: 生成确定性的、合法的大规模 cminus 程序, 用于编译吞吐测试
+//
+// 相同的参数 (包括 -seed) 总是生成相同的程序. 生成的程序可以正常运行结束:
+// 循环次数固定, 数组下标总在范围内, 函数之间只有无环的调用链.
+// 嵌套 while 的迭代次数之积不超过 kMaxTrips, 超过时改为生成 if,
+// 因此即使 -depth 很大, 每个函数的运行时间也有上限.
+
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+
+using std::string;
+using std::operator""s;
+
+namespace {
+
+struct GenConfig {
+    unsigned seed{1};
+    unsigned funcs{100};    // 函数个数 (不含 main)
+    unsigned depth{3};      // if/while 的最大嵌套层数
+    unsigned stmts{10};     // 每个语句块中的简单语句条数
+    unsigned locals{8};     // 每个函数的 int 局部变量个数
+    unsigned arrays{2};     // 每个函数的局部数组个数
+    unsigned array_size{16};
+    unsigned globals{4};    // int 全局变量个数 (另有一个全局数组)
+    unsigned chain{8};      // 调用链长度: 第 i 个函数调用第 i-1 个, 每 chain 个一段
+    unsigned loop_trip{3};  // 每个 while 的迭代次数
+    unsigned expr_depth{2}; // 表达式的最大深度
+    std::string output_file;
+};
+
+class ProgramGenerator {
+  public:
+    explicit ProgramGenerator(const GenConfig &config)
+        : config_(config), rng_(config.seed) {}
+
+    void generate(std::ostream &os) {
+        gen_globals();
+        for (unsigned i = 0; i < config_.funcs; ++i)
+            gen_function(i);
+        gen_main();
+        os << out_.str();
+    }
+
+  private:
+    // 一个函数中嵌套 while 的迭代次数之积的上限
+    static constexpr unsigned long kMaxTrips = 4096;
+
+    const GenConfig &config_;
+    // mt19937 的输出序列由标准规定, 这里只对其取模, 保证跨平台确定
+    std::mt19937 rng_;
+    std::ostringstream out_;
+    unsigned indent_{0};
+    unsigned long trips_{1}; // 外层 while 的迭代次数之积
+
+    unsigned rand(unsigned n) { return n == 0 ? 0 : rng_() % n; }
+    bool coin() { return rand(2) == 0; }
+
+    std::ostream &line() {
+        for (unsigned i = 0; i < indent_; ++i)
+            out_ << "    ";
+        return out_;
+    }
+
+    // cminus 的标识符只含字母: 小写前缀加大写字母编号 (A, B, ..., Z, AA, ...),
+    // 不同前缀之间不会冲突, 也不会与关键字冲突
+    static string ident(const char *prefix, unsigned i) {
+        string suffix;
+        do {
+            suffix.insert(suffix.begin(), char('A' + i % 26));
+            i /= 26;
+        } while (i-- != 0);
+        return prefix + suffix;
+    }
+    static string local(unsigned i) { return ident("v", i); }
+    static string array(unsigned i) { return ident("a", i); }
+    static string counter(unsigned level) { return ident("c", level); }
+    static string global(unsigned i) { return ident("g", i); }
+    static string param(unsigned i) { return ident("p", i); }
+    static string func(unsigned i) { return ident("f", i); }
+
+    string gen_leaf() {
+        unsigned idx = rand(config_.array_size);
+        switch (rand(6)) {
+        case 0:
+            return std::to_string(rand(100));
+        case 1:
+            return param(rand(2));
+        case 2:
+            if (config_.arrays != 0)
+                return array(rand(config_.arrays)) + "[" +
+                       std::to_string(idx) + "]";
+            return "arr[" + std::to_string(idx) + "]";
+        case 3:
+            if (config_.globals != 0)
+                return global(rand(config_.globals));
+            return "ga[" + std::to_string(idx) + "]";
+        default:
+            return local(rand(config_.locals));
+        }
+    }
+
+    string gen_expr(unsigned depth) {
+        if (depth == 0 or rand(3) == 0)
+            return gen_leaf();
+        static const char *ops[] = {"+", "-", "*"};
+        auto lhs = gen_expr(depth - 1);
+        auto rhs = gen_expr(depth - 1);
+        return "(" + lhs + " " + ops[rand(3)] + " " + rhs + ")";
+    }
+
+    string gen_cond() {
+        static const char *relops[] = {"<", "<=", ">", ">=", "==", "!="};
+        return gen_expr(config_.expr_depth) + " " + relops[rand(6)] + " " +
+               gen_expr(config_.expr_depth);
+    }
+
+    void gen_simple_stmt() {
+        auto expr = gen_expr(config_.expr_depth);
+        switch (rand(5)) {
+        case 0:
+            if (config_.arrays != 0) {
+                line() << array(rand(config_.arrays)) << "["
+                       << rand(config_.array_size) << "] = " << expr << ";\n";
+                return;
+            }
+            break;
+        case 1:
+            line() << "w = w + " << expr << " * 0.5;\n";
+            return;
+        case 2:
+            if (config_.globals != 0) {
+                line() << global(rand(config_.globals)) << " = " << expr
+                       << ";\n";
+                return;
+            }
+            break;
+        default:
+            break;
+        }
+        line() << local(rand(config_.locals)) << " = " << expr << ";\n";
+    }
+
+    // 一个语句块: stmts 条简单语句, 未到最大深度时在随机位置插入一条 if/while
+    void gen_block(unsigned level) {
+        unsigned nested_at =
+            level < config_.depth ? rand(config_.stmts + 1) : ~0u;
+        for (unsigned i = 0; i <= config_.stmts; ++i) {
+            if (i == nested_at)
+                gen_nested_stmt(level);
+            else if (i < config_.stmts)
+                gen_simple_stmt();
+        }
+    }
+
+    void gen_nested_stmt(unsigned level) {
+        if (coin() or trips_ * config_.loop_trip > kMaxTrips) {
+            line() << "if (" << gen_cond() << ") {\n";
+            ++indent_;
+            gen_block(level + 1);
+            --indent_;
+            if (coin()) {
+                line() << "} else {\n";
+                ++indent_;
+                for (unsigned i = 0; i < config_.stmts; ++i)
+                    gen_simple_stmt();
+                --indent_;
+            }
+            line() << "}\n";
+        } else {
+            auto c = counter(level);
+            line() << c << " = 0;\n";
+            line() << "while (" << c << " < " << config_.loop_trip << ") {\n";
+            ++indent_;
+            trips_ *= config_.loop_trip;
+            gen_block(level + 1);
+            trips_ /= config_.loop_trip;
+            line() << c << " = " << c << " + 1;\n";
+            --indent_;
+            line() << "}\n";
+        }
+    }
+
+    void gen_array_init(const string &name) {
+        auto c = counter(0);
+        line() << c << " = 0;\n";
+        line() << "while (" << c << " < " << config_.array_size << ") {\n";
+        ++indent_;
+        line() << name << "[" << c << "] = " << c << ";\n";
+        line() << c << " = " << c << " + 1;\n";
+        --indent_;
+        line() << "}\n";
+    }
+
+    void gen_globals() {
+        for (unsigned i = 0; i < config_.globals; ++i)
+            out_ << "int " << global(i) << ";\n";
+        out_ << "int ga[" << config_.array_size << "];\n\n";
+    }
+
+    void gen_function(unsigned i) {
+        out_ << "int " << func(i) << "(int " << param(0) << ", int "
+             << param(1) << ", int arr[]) {\n";
+        indent_ = 1;
+        for (unsigned j = 0; j < config_.locals; ++j)
+            line() << "int " << local(j) << ";\n";
+        for (unsigned j = 0; j < config_.arrays; ++j)
+            line() << "int " << array(j) << "[" << config_.array_size
+                   << "];\n";
+        for (unsigned j = 0; j <= config_.depth; ++j)
+            line() << "int " << counter(j) << ";\n";
+        line() << "float w;\n";
+
+        for (unsigned j = 0; j < config_.locals; ++j)
+            line() << local(j) << " = " << param(j % 2) << " + " << j
+                   << ";\n";
+        for (unsigned j = 0; j < config_.arrays; ++j)
+            gen_array_init(array(j));
+        line() << "w = 0.0;\n";
+
+        gen_block(0);
+
+        if (i % config_.chain != 0) {
+            auto arg = config_.arrays != 0 ? array(0) : "arr"s;
+            line() << local(0) << " = " << local(0) << " + " << func(i - 1)
+                   << "("
+                   << local(1 % config_.locals) << ", "
+                   << local(2 % config_.locals) << ", " << arg << ");\n";
+        }
+        line() << "if (w > 0.0) {\n";
+        line() << "    " << local(0) << " = " << local(0) << " + 1;\n";
+        line() << "}\n";
+        line() << "return " << local(0) << " + "
+               << local(config_.locals - 1) << ";\n";
+        out_ << "}\n\n";
+        indent_ = 0;
+    }
+
+    // main 调用每条调用链的最后一个函数
+    void gen_main() {
+        out_ << "void main(void) {\n";
+        indent_ = 1;
+        line() << "int r;\n";
+        line() << "int " << counter(0) << ";\n";
+        line() << "int a[" << config_.array_size << "];\n";
+        gen_array_init("a");
+        gen_array_init("ga");
+        line() << "r = 0;\n";
+        for (unsigned i = 0; i < config_.funcs; ++i) {
+            if (i % config_.chain == config_.chain - 1 or
+                i + 1 == config_.funcs)
+                line() << "r = r + " << func(i) << "(" << i << ", " << i + 1
+                       << ", a);\n";
+        }
+        line() << "output(r);\n";
+        line() << "return;\n";
+        out_ << "}\n";
+        indent_ = 0;
+    }
+};
+
+void print_help(const char *exe_name) {
+    std::cout
+        << "Usage: " << exe_name
+        << " [-h|--help] [-o <file>] [-seed N] [-funcs N] [-depth N]"
+           " [-stmts N] [-locals N] [-arrays N] [-array-size N]"
+           " [-globals N] [-chain N] [-loop-trip N] [-expr-depth N]\n";
+    exit(0);
+}
+
+void print_err(const char *exe_name, const string &msg) {
+    std::cout << exe_name << ": " << msg << std::endl;
+    exit(-1);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    GenConfig config;
+    struct {
+        const char *flag;
+        unsigned *value;
+    } options[] = {
+        {"-seed", &config.seed},
+        {"-funcs", &config.funcs},
+        {"-depth", &config.depth},
+        {"-stmts", &config.stmts},
+        {"-locals", &config.locals},
+        {"-arrays", &config.arrays},
+        {"-array-size", &config.array_size},
+        {"-globals", &config.globals},
+        {"-chain", &config.chain},
+        {"-loop-trip", &config.loop_trip},
+        {"-expr-depth", &config.expr_depth},
+    };
+
+    for (int i = 1; i < argc; ++i) {
+        if (argv[i] == "-h"s || argv[i] == "--help"s)
+            print_help(argv[0]);
+        if (i + 1 >= argc)
+            print_err(argv[0], "missing value for \'"s + argv[i] + "\'");
+        if (argv[i] == "-o"s) {
+            config.output_file = argv[++i];
+            continue;
+        }
+        bool matched = false;
+        for (auto &option : options) {
+            if (argv[i] == string(option.flag)) {
+                try {
+                    *option.value = std::stoul(argv[i + 1]);
+                } catch (const std::exception &) {
+                    print_err(argv[0], "bad value for \'"s + argv[i] + "\'");
+                }
+                matched = true;
+                ++i;
+                break;
+            }
+        }
+        if (not matched)
+            print_err(argv[0],
+                      "unrecognized command-line option \'"s + argv[i] + "\'");
+    }
+    if (config.locals == 0 or config.chain == 0 or config.array_size == 0 or
+        config.loop_trip == 0)
+        print_err(argv[0], "-locals, -chain, -array-size and -loop-trip "
+                           "must be positive");
+
+    ProgramGenerator gen(config);
+    if (config.output_file.empty()) {
+        gen.generate(std::cout);
+    } else {
+        std::ofstream os(config.output_file);
+        gen.generate(os);
+    }
+    return 0;
+}
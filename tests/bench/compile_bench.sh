@@ -0,0 +1,67 @@
+#!/bin/bash
+
+# 编译吞吐测试: 用 cminus-gen 生成几种形状的大程序, 分别在不同优化选项下
+# 用 cminusfc -time-report 编译, 把各阶段耗时汇总成一个 JSON 文件
+#
+# Usage: compile_bench.sh <cminus-gen> <cminusfc> <output-json> [work-dir]
+
+set -e
+
+if [ $# -lt 3 ]; then
+    echo "Usage: $0 <cminus-gen> <cminusfc> <output-json> [work-dir]"
+    exit 1
+fi
+
+GEN=$1
+CMINUSFC=$2
+OUTPUT=$3
+WORK_DIR=${4:-$(dirname "$OUTPUT")/compile-bench}
+
+mkdir -p "$WORK_DIR"
+
+# 形状名 及其 cminus-gen 参数
+SHAPES=(
+    "many_funcs:-funcs 300 -depth 1 -stmts 4"
+    "huge_module:-funcs 3000 -depth 1 -stmts 3"
+    "deep_nesting:-funcs 20 -depth 40 -stmts 3"
+    "straight_line:-funcs 2 -depth 0 -stmts 3000"
+    "many_locals:-funcs 30 -locals 300 -arrays 30"
+    "call_chain:-funcs 300 -chain 300 -depth 0 -stmts 2"
+)
+
+# 优化选项组合, 空串表示不优化
+PIPELINES=(
+    ""
+    "-dce"
+    "-dce -func-inline"
+    # 全部优化
+    "-dce -memoize -tre -func-inline -global-opt -sroa -func-spec -ipsccp -gvn -rle -dse -licm -lsr -rce -loop-version -unroll"
+)
+
+first=1
+echo "{\"benchmarks\": [" > "$OUTPUT"
+for shape in "${SHAPES[@]}"; do
+    name=${shape%%:*}
+    args=${shape#*:}
+    src="$WORK_DIR/$name.cminus"
+    # shellcheck disable=SC2086
+    "$GEN" -seed 1 $args -o "$src"
+
+    for flags in "${PIPELINES[@]}"; do
+        echo "[info] $name ${flags:-(no opt)}"
+        report="$WORK_DIR/$name.time.json"
+        # shellcheck disable=SC2086
+        "$CMINUSFC" -emit-llvm $flags "$src" -o "$WORK_DIR/$name.ll" \
+            -time-report "$report"
+        if [ $first -eq 0 ]; then
+            echo "," >> "$OUTPUT"
+        fi
+        first=0
+        printf '{"shape": "%s", "flags": "%s", "report": %s}' \
+            "$name" "$flags" "$(cat "$report")" >> "$OUTPUT"
+    done
+done
+echo "" >> "$OUTPUT"
+echo "]}" >> "$OUTPUT"
+
+echo "[info] results written to $OUTPUT"
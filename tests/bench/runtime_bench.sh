@@ -0,0 +1,63 @@
+#!/bin/bash
+
+# 运行时间测试: 分别在不同优化选项下编译 recursion/ 中的递归程序,
+# 链接运行时库后计时运行, 并检查各选项下的输出一致, 结果写入一个 JSON 文件
+#
+# Usage: runtime_bench.sh <cminusfc> <io-lib-dir> <output-json> [work-dir]
+
+set -e
+
+if [ $# -lt 3 ]; then
+    echo "Usage: $0 <cminusfc> <io-lib-dir> <output-json> [work-dir]"
+    exit 1
+fi
+
+CMINUSFC=$1
+IO_LIB_DIR=$2
+OUTPUT=$3
+WORK_DIR=${4:-$(dirname "$OUTPUT")/runtime-bench}
+SRC_DIR=$(dirname "$0")/recursion
+
+mkdir -p "$WORK_DIR"
+
+# 优化选项组合, 第一个作为比较输出的基准
+PIPELINES=(
+    "-dce"
+    "-dce -memoize"
+)
+
+first=1
+echo "{\"benchmarks\": [" > "$OUTPUT"
+for src in "$SRC_DIR"/*.cminus; do
+    name=$(basename "$src" .cminus)
+    expected=""
+    for flags in "${PIPELINES[@]}"; do
+        echo "[info] $name $flags"
+        exe="$WORK_DIR/$name"
+        # shellcheck disable=SC2086
+        "$CMINUSFC" -emit-llvm $flags "$src" -o "$exe.ll"
+        clang -O0 -w -no-pie "$exe.ll" -o "$exe" -L "$IO_LIB_DIR" -lcminus_io
+
+        start=$(date +%s%N)
+        # main 的返回值不是程序是否出错的标志
+        "$exe" > "$exe.out" || true
+        end=$(date +%s%N)
+        if [ -z "$expected" ]; then
+            expected=$(cat "$exe.out")
+        elif [ "$(cat "$exe.out")" != "$expected" ]; then
+            echo "[error] $name: output differs with $flags"
+            exit 1
+        fi
+
+        if [ $first -eq 0 ]; then
+            echo "," >> "$OUTPUT"
+        fi
+        first=0
+        printf '{"program": "%s", "flags": "%s", "ms": %d}' \
+            "$name" "$flags" $(((end - start) / 1000000)) >> "$OUTPUT"
+    done
+done
+echo "" >> "$OUTPUT"
+echo "]}" >> "$OUTPUT"
+
+echo "[info] results written to $OUTPUT"